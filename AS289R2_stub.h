@@ -18,6 +18,7 @@ public:
     void setDoubleSizeWidth(void) {};
     void clearDoubleSizeWidth(void) {};
     int printf(const char *format, ...) {return 0;};
+    ssize_t write(const void *buffer, size_t length) {return length;};
 };
 
 #endif
@@ -0,0 +1,75 @@
+/* Compile-time bit field schemas for card record layouts
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef BIT_FIELD_H_
+#define BIT_FIELD_H_
+
+#include <stdint.h>
+#include <type_traits>
+
+/* --------------------------------
+ * Constant
+ * -------------------------------- */
+
+/* bit_field byte order */
+#define BIT_FIELD_BE                  0           // MSB first, bit offset counted from the MSB of byte 0
+#define BIT_FIELD_LE                  1           // LSB first, whole bytes only
+
+/* --------------------------------
+ * Class Declaration
+ * -------------------------------- */
+
+/*
+ * One field of a packed record: bit offset, width and byte order are
+ * template arguments, so get() reads exactly the bytes that hold the
+ * field with constant shifts and masks, and works in constant
+ * expressions. A record layout is a struct of bit_field typedefs:
+ *
+ *   struct layout {
+ *       typedef bit_field<0, 7> year;       // bits 0-6 of the record
+ *       typedef bit_field<80, 16, BIT_FIELD_LE> balance;
+ *   };
+ *   uint32_t year = layout::year::get(block);
+ */
+template <unsigned Offset, unsigned Width, int Order = BIT_FIELD_BE>
+struct bit_field {
+    static_assert((Width > 0) && (Width <= 32), "field wider than 32 bits");
+    static_assert((Order == BIT_FIELD_BE) || (((Offset % 8) == 0) && ((Width % 8) == 0)),
+                  "little endian fields must be whole bytes");
+
+    static constexpr unsigned offset = Offset;
+    static constexpr unsigned width = Width;
+    static constexpr unsigned end = Offset + Width;          // first bit after the field
+    static constexpr unsigned first = Offset / 8;            // first byte read
+    static constexpr unsigned bytes = (end + 7) / 8 - first; // bytes read, at most 5
+    static constexpr uint32_t mask = (Width == 32) ? 0xFFFFFFFFu : ((1u << (Width % 32)) - 1);
+
+    // a 64-bit word only for fields spread over 5 bytes
+    typedef typename std::conditional<(bytes > 4), uint64_t, uint32_t>::type word;
+
+    static constexpr uint32_t get(const uint8_t *p)
+    {
+        word v = 0;
+
+        if (Order == BIT_FIELD_LE) {
+            for (unsigned i = bytes; i > 0; i--) {
+                v = (v << 8) | p[first + i - 1];
+            }
+            return (uint32_t)v;
+        }
+        for (unsigned i = 0; i < bytes; i++) {
+            v = (v << 8) | p[first + i];
+        }
+        return (uint32_t)(v >> (bytes * 8 - (Offset % 8) - Width)) & mask;
+    }
+};
+
+/* the layout fits in a record of size bytes */
+template <class Field>
+constexpr bool bit_field_fits(unsigned size)
+{
+    return Field::end <= size * 8;
+}
+
+#endif /* !BIT_FIELD_H_ */
@@ -0,0 +1,133 @@
+/* Card family prediction from the polling response
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include "CardClassifier.h"
+
+/* --------------------------------
+ * Function
+ * -------------------------------- */
+
+card_signature card_signature_of(uint16_t system_code, const uint8_t *idm, const uint8_t *pmm)
+{
+    card_signature sig;
+
+    sig.system_code = system_code;
+    sig.manufacturer = (uint16_t)((idm[0] << 8) | idm[1]);
+    sig.ic_type = pmm[1];
+    return sig;
+}
+
+static int same_signature(const card_signature &a, const card_signature &b)
+{
+    return (a.system_code == b.system_code) && (a.manufacturer == b.manufacturer) && (a.ic_type == b.ic_type);
+}
+
+CardClassifier::CardClassifier() :
+    _rule_count(0),
+    _clock(0),
+    _predictions(0),
+    _misses(0)
+{
+    memset(_entries, 0, sizeof(_entries));
+    for (int i = 0; i < CLASSIFIER_ENTRIES; i++) {
+        _entries[i].family = CARD_FAMILY_UNKNOWN;
+    }
+}
+
+int CardClassifier::addRule(uint16_t system_code, int family)
+{
+    if ((_rule_count == CLASSIFIER_RULES) || (family < 0)) {
+        return 0;
+    }
+    _rules[_rule_count].system_code = system_code;
+    _rules[_rule_count].family = (int8_t)family;
+    _rule_count++;
+    return 1;
+}
+
+CardClassifier::entry *CardClassifier::find(const card_signature &sig)
+{
+    for (int i = 0; i < CLASSIFIER_ENTRIES; i++) {
+        if ((_entries[i].family != CARD_FAMILY_UNKNOWN) && same_signature(_entries[i].sig, sig)) {
+            return &_entries[i];
+        }
+    }
+    return NULL;
+}
+
+int CardClassifier::predict(const card_signature &sig)
+{
+    for (int i = 0; i < _rule_count; i++) {
+        if (_rules[i].system_code == sig.system_code) {
+            _predictions++;
+            return _rules[i].family;
+        }
+    }
+
+    entry *e = find(sig);
+    if ((e == NULL) || (e->count < CLASSIFIER_CONFIDENCE)) {
+        return CARD_FAMILY_UNKNOWN;
+    }
+    e->used = ++_clock;
+    _predictions++;
+    if ((_predictions % CLASSIFIER_AUDIT_INTERVAL) == 0) {
+        return CARD_FAMILY_UNKNOWN;
+    }
+    return e->family;
+}
+
+void CardClassifier::learn(const card_signature &sig, int predicted, int family)
+{
+    if ((predicted != CARD_FAMILY_UNKNOWN) && (predicted != family)) {
+        _misses++;
+    }
+
+    entry *e = find(sig);
+    if (e != NULL) {
+        if (family == CARD_FAMILY_UNKNOWN) {
+            e->family = CARD_FAMILY_UNKNOWN;    // nothing to confirm with a single probe
+        }
+        else if (e->family == family) {
+            if (e->count < 0xFF) {
+                e->count++;
+            }
+        }
+        else {
+            e->family = (int8_t)family;
+            e->count = 1;
+        }
+        e->used = ++_clock;
+        return;
+    }
+    if (family == CARD_FAMILY_UNKNOWN) {
+        return;
+    }
+
+    // a free entry, or the one unused for the longest time
+    e = &_entries[0];
+    for (int i = 0; i < CLASSIFIER_ENTRIES; i++) {
+        if (_entries[i].family == CARD_FAMILY_UNKNOWN) {
+            e = &_entries[i];
+            break;
+        }
+        if (_entries[i].used < e->used) {
+            e = &_entries[i];
+        }
+    }
+    e->sig = sig;
+    e->family = (int8_t)family;
+    e->count = 1;
+    e->used = ++_clock;
+}
+
+uint32_t CardClassifier::predictions(void) const
+{
+    return _predictions;
+}
+
+uint32_t CardClassifier::misses(void) const
+{
+    return _misses;
+}
@@ -0,0 +1,81 @@
+/* Card family prediction from the polling response
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef CARD_CLASSIFIER_H_
+#define CARD_CLASSIFIER_H_
+
+#include <stdint.h>
+
+/* --------------------------------
+ * Constant
+ * -------------------------------- */
+
+#define CARD_FAMILY_UNKNOWN           -1
+#define CLASSIFIER_ENTRIES            16          // learned signatures
+#define CLASSIFIER_RULES              4           // fixed system code rules
+#define CLASSIFIER_CONFIDENCE         2           // agreeing taps before a signature is trusted
+#define CLASSIFIER_AUDIT_INTERVAL     16          // every n-th learned prediction is withheld
+
+/* --------------------------------
+ * Structure
+ * -------------------------------- */
+
+/* what polling() tells about a card before any service is probed */
+struct card_signature {
+    uint16_t system_code;       // system code that answered the polling
+    uint16_t manufacturer;      // IDm bytes 0-1, manufacturer code
+    uint8_t ic_type;            // PMm byte 1, IC code
+};
+
+card_signature card_signature_of(uint16_t system_code, const uint8_t *idm, const uint8_t *pmm);
+
+/* --------------------------------
+ * Class Declaration
+ * -------------------------------- */
+
+/*
+ * Predicts which of the caller's probes (a family index) will identify a
+ * card. A rule maps a system code to a family outright; otherwise the
+ * family the probes found for earlier cards with the same signature is
+ * used once it has agreed CLASSIFIER_CONFIDENCE times. The caller
+ * confirms a prediction with a single probe and falls back to probing
+ * everything on a miss; every CLASSIFIER_AUDIT_INTERVAL-th learned
+ * prediction is withheld so a signature shared by two families is noticed.
+ */
+class CardClassifier
+{
+public:
+    CardClassifier();
+
+    int addRule(uint16_t system_code, int family);
+
+    int predict(const card_signature &sig);
+    void learn(const card_signature &sig, int predicted, int family);
+
+    uint32_t predictions(void) const;           // predictions made
+    uint32_t misses(void) const;                // predictions the probes did not confirm
+
+private:
+    struct rule {
+        uint16_t system_code;
+        int8_t family;
+    };
+    struct entry {
+        card_signature sig;
+        int8_t family;
+        uint8_t count;
+        uint32_t used;
+    };
+
+    entry *find(const card_signature &sig);
+
+    rule _rules[CLASSIFIER_RULES];
+    int _rule_count;
+    entry _entries[CLASSIFIER_ENTRIES];
+    uint32_t _clock;
+    uint32_t _predictions;
+    uint32_t _misses;
+};
+
+#endif /* !CARD_CLASSIFIER_H_ */
@@ -0,0 +1,71 @@
+/* Layouts of the card history blocks
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef CARD_LAYOUT_H_
+#define CARD_LAYOUT_H_
+
+#include "BitField.h"
+
+/*
+ * Every field of a 16-byte history block as a bit_field. Timestamps are
+ * given as the byte offset of the packed value, decoded with the
+ * matching *_time_layout of DateTime.h. The layouts are checked against
+ * sample blocks in History.cpp.
+ */
+
+/* Suica, PASMO and the other transit cards */
+struct cyberne_layout {
+    typedef bit_field<0, 8> terminal;
+    typedef bit_field<8, 8> process;
+    typedef bit_field<16, 8> payment;
+    typedef bit_field<24, 8> gate;
+    static constexpr unsigned date = 4;         // cjrc_date_layout
+    static constexpr unsigned time = 6;         // cjrc_time_layout, sales records only
+    typedef bit_field<48, 8> line_in;
+    typedef bit_field<56, 8> station_in;
+    typedef bit_field<64, 8> line_out;
+    typedef bit_field<72, 8> station_out;
+    typedef bit_field<80, 16, BIT_FIELD_LE> balance;
+    typedef bit_field<104, 16> sequence;
+    typedef bit_field<120, 2> region_in;
+    typedef bit_field<122, 2> region_out;
+};
+
+struct ecomyca_layout {
+    static constexpr unsigned date = 0;         // cjrc_date_layout
+    static constexpr unsigned time = 2;         // ecomyca_time_layout
+    typedef bit_field<72, 4> terminal;
+    typedef bit_field<76, 4> process;
+    typedef bit_field<80, 16> amount;
+    typedef bit_field<112, 16> balance;
+};
+
+struct edy_layout {
+    typedef bit_field<0, 8> process;
+    static constexpr unsigned time = 4;         // edy_time_layout
+    typedef bit_field<64, 32> amount;
+    typedef bit_field<96, 32> balance;
+};
+
+struct nanaco_layout {
+    typedef bit_field<0, 8> process;
+    typedef bit_field<24, 16> amount;
+    typedef bit_field<56, 16> balance;
+    static constexpr unsigned time = 9;         // nanaco_time_layout
+};
+
+/* WAON keeps the sequence number in the block before the record */
+struct waon_head_layout {
+    typedef bit_field<104, 16> sequence;
+};
+
+struct waon_layout {
+    typedef bit_field<8, 8> process;
+    static constexpr unsigned time = 2;         // waon_time_layout
+    typedef bit_field<41, 18> balance;
+    typedef bit_field<59, 18> amount;
+    typedef bit_field<77, 17> charge;
+};
+
+#endif /* !CARD_LAYOUT_H_ */
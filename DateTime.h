@@ -0,0 +1,230 @@
+/* Integer date and time decoding for card timestamps
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef DATE_TIME_H_
+#define DATE_TIME_H_
+
+#include <stdint.h>
+
+#include "BitField.h"
+
+/*
+ * Every card stores local (JST) time in its own packed format. These
+ * decoders only do integer arithmetic: no mktime(), localtime() or time
+ * zone, and all of them are constexpr so reference values are checked
+ * at compile time (see the end of this file, and tools/date-check for
+ * the exhaustive comparison against the C library on Linux).
+ */
+
+/* --------------------------------
+ * Constant
+ * -------------------------------- */
+
+#define DATE_TIME_EPOCH_YEAR          2000        // day 0 of days_from_civil()
+#define DATE_TIME_DAY_SECONDS         86400L
+
+/* --------------------------------
+ * Structure
+ * -------------------------------- */
+
+struct date_time {
+    uint16_t year;
+    uint8_t month;              // 1-12
+    uint8_t day;                // 1-31
+    uint8_t hour;
+    uint8_t minute;
+    uint8_t second;
+};
+
+/* --------------------------------
+ * Function
+ * -------------------------------- */
+
+constexpr bool is_leap_year(int year)
+{
+    return ((year % 4) == 0) && (((year % 100) != 0) || ((year % 400) == 0));
+}
+
+constexpr int days_in_month(int year, int month)
+{
+    return (month == 2) ? (is_leap_year(year) ? 29 : 28)
+           : ((month == 4) || (month == 6) || (month == 9) || (month == 11)) ? 30 : 31;
+}
+
+/* days since 2000-01-01 of a proleptic Gregorian date, year >= 1 */
+constexpr int32_t days_from_civil(int year, int month, int day)
+{
+    // years start on March 1st so the leap day is the last day of a year
+    int y = year - ((month <= 2) ? 1 : 0);
+    int era = y / 400;
+    int yoe = y - era * 400;
+    int doy = (153 * ((month > 2) ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+
+    return (int32_t)era * 146097 + doe - 730425;
+}
+
+/* inverse of days_from_civil(), days >= -730425 */
+constexpr date_time civil_from_days(int32_t days)
+{
+    uint32_t z = (uint32_t)(days + 730425);     // days since 0000-03-01
+    uint32_t era = z / 146097;
+    uint32_t doe = z - era * 146097;
+    uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    uint32_t mp = (5 * doy + 2) / 153;
+    uint8_t month = (uint8_t)((mp < 10) ? mp + 3 : mp - 9);
+
+    return date_time {
+        (uint16_t)(yoe + era * 400 + ((month <= 2) ? 1 : 0)),
+        month,
+        (uint8_t)(doy - (153 * mp + 2) / 5 + 1),
+        0, 0, 0
+    };
+}
+
+/* civil date and time of a second count since 2000-01-01 00:00:00 */
+constexpr date_time civil_from_seconds(int64_t seconds)
+{
+    int32_t days = (int32_t)(seconds / DATE_TIME_DAY_SECONDS);
+    int32_t sec = (int32_t)(seconds % DATE_TIME_DAY_SECONDS);
+
+    if (sec < 0) {
+        days--;
+        sec += DATE_TIME_DAY_SECONDS;
+    }
+    date_time dt = civil_from_days(days);
+    dt.hour = (uint8_t)(sec / 3600);
+    dt.minute = (uint8_t)((sec / 60) % 60);
+    dt.second = (uint8_t)(sec % 60);
+    return dt;
+}
+
+/* ------------------------
+ * card formats
+ * ------------------------ */
+
+/* CJRC (Suica, ecomyca) date: year(7, from 2000) month(4) day(5) */
+struct cjrc_date_layout {
+    typedef bit_field<0, 7> year;
+    typedef bit_field<7, 4> month;
+    typedef bit_field<11, 5> day;
+};
+
+/* CJRC sales records: hour(5) minute(6) second(5) */
+struct cjrc_time_layout {
+    typedef bit_field<0, 5> hour;
+    typedef bit_field<5, 6> minute;
+    typedef bit_field<11, 5> second;
+};
+
+/* ecomyca: start and end of the use */
+struct ecomyca_time_layout {
+    typedef bit_field<0, 6> hour;
+    typedef bit_field<6, 6> minute;
+    typedef bit_field<12, 6> end_hour;
+    typedef bit_field<18, 6> end_minute;
+};
+
+/* Edy: days since 2000-01-01, seconds since midnight */
+struct edy_time_layout {
+    typedef bit_field<0, 15> days;
+    typedef bit_field<15, 17> seconds;
+};
+
+/* nanaco: year(11, from 2000) month(4) day(5) hour(6) minute(6) */
+struct nanaco_time_layout {
+    typedef bit_field<0, 11> year;
+    typedef bit_field<11, 4> month;
+    typedef bit_field<15, 5> day;
+    typedef bit_field<20, 6> hour;
+    typedef bit_field<26, 6> minute;
+};
+
+/* WAON: year(5, from 2005) month(4) day(5) hour(5) minute(6) */
+struct waon_time_layout {
+    typedef bit_field<0, 5> year;
+    typedef bit_field<5, 4> month;
+    typedef bit_field<9, 5> day;
+    typedef bit_field<14, 5> hour;
+    typedef bit_field<19, 6> minute;
+};
+
+template <class Layout>
+constexpr date_time decode_date_time(const uint8_t *p, int year_base)
+{
+    return date_time {
+        (uint16_t)(year_base + Layout::year::get(p)),
+        (uint8_t)Layout::month::get(p),
+        (uint8_t)Layout::day::get(p),
+        (uint8_t)Layout::hour::get(p),
+        (uint8_t)Layout::minute::get(p),
+        0
+    };
+}
+
+constexpr date_time decode_date_cjrc(const uint8_t *p)
+{
+    return date_time {
+        (uint16_t)(2000 + cjrc_date_layout::year::get(p)),
+        (uint8_t)cjrc_date_layout::month::get(p),
+        (uint8_t)cjrc_date_layout::day::get(p),
+        0, 0, 0
+    };
+}
+
+constexpr date_time decode_time_cjrc(const uint8_t *p)
+{
+    return date_time {
+        0, 0, 0,
+        (uint8_t)cjrc_time_layout::hour::get(p),
+        (uint8_t)cjrc_time_layout::minute::get(p),
+        (uint8_t)cjrc_time_layout::second::get(p)
+    };
+}
+
+/* index 0 is the start of the use, 1 the end */
+constexpr date_time decode_time_ecomyca(const uint8_t *p, int index)
+{
+    return (index == 0)
+           ? date_time { 0, 0, 0, (uint8_t)ecomyca_time_layout::hour::get(p), (uint8_t)ecomyca_time_layout::minute::get(p), 0 }
+           : date_time { 0, 0, 0, (uint8_t)ecomyca_time_layout::end_hour::get(p), (uint8_t)ecomyca_time_layout::end_minute::get(p), 0 };
+}
+
+constexpr date_time decode_date_time_edy(const uint8_t *p)
+{
+    return civil_from_seconds((int64_t)edy_time_layout::days::get(p) * DATE_TIME_DAY_SECONDS
+                              + edy_time_layout::seconds::get(p));
+}
+
+constexpr date_time decode_date_time_nanaco(const uint8_t *p)
+{
+    return decode_date_time<nanaco_time_layout>(p, 2000);
+}
+
+constexpr date_time decode_date_time_waon(const uint8_t *p)
+{
+    return decode_date_time<waon_time_layout>(p, 2005);
+}
+
+/* ------------------------
+ * reference values
+ * ------------------------ */
+
+constexpr bool date_time_equal(const date_time &a, int year, int month, int day, int hour = 0, int minute = 0, int second = 0)
+{
+    return (a.year == year) && (a.month == month) && (a.day == day)
+           && (a.hour == hour) && (a.minute == minute) && (a.second == second);
+}
+
+static_assert(days_from_civil(2000, 1, 1) == 0, "epoch");
+static_assert(days_from_civil(2000, 3, 1) == 60, "leap day of 2000");
+static_assert(days_from_civil(2024, 2, 29) == 8825, "leap day of 2024");
+static_assert(days_from_civil(1970, 1, 1) == -10957, "Unix epoch");
+static_assert(date_time_equal(civil_from_days(8825), 2024, 2, 29), "leap day of 2024");
+static_assert(date_time_equal(civil_from_days(-1), 1999, 12, 31), "day before the epoch");
+static_assert(date_time_equal(civil_from_seconds(32767L * 86400 + 86399), 2089, 9, 17, 23, 59, 59), "last Edy day");
+static_assert(!is_leap_year(2100) && is_leap_year(2000) && (days_in_month(2023, 2) == 28), "leap years");
+
+#endif /* !DATE_TIME_H_ */
@@ -0,0 +1,222 @@
+/* Binary event frames for USB serial
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+
+#include "EventFrame.h"
+
+/* --------------------------------
+ * Constant
+ * -------------------------------- */
+
+/* EventFrameParser states */
+#define STATE_SYNC                    0
+#define STATE_TYPE                    1
+#define STATE_LENGTH_LOW              2
+#define STATE_LENGTH_HIGH             3
+#define STATE_PAYLOAD                 4
+#define STATE_CRC_LOW                 5
+#define STATE_CRC_HIGH                6
+
+/* --------------------------------
+ * Function
+ * -------------------------------- */
+
+uint16_t event_frame_crc(uint16_t crc, const uint8_t *data, int len)
+{
+    for (int i = 0; i < len; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+int event_frame_encode(uint8_t type, const uint8_t *payload, int len, uint8_t *frame, int size)
+{
+    if ((len < 0) || (len > EVENT_FRAME_LENGTH_MAX) || (size < len + EVENT_FRAME_OVERHEAD)) {
+        return 0;
+    }
+    memcpy(&frame[EVENT_FRAME_HEADER], payload, len);
+    return event_frame_seal(type, frame, len);
+}
+
+int event_frame_seal(uint8_t type, uint8_t *frame, int len)
+{
+    uint16_t crc;
+
+    if ((len < 0) || (len > EVENT_FRAME_LENGTH_MAX)) {
+        return 0;
+    }
+
+    frame[0] = EVENT_FRAME_SYNC;
+    frame[1] = type;
+    frame[2] = (uint8_t)len;
+    frame[3] = (uint8_t)(len >> 8);
+    crc = event_frame_crc(0xFFFF, &frame[1], len + 3);
+    frame[EVENT_FRAME_HEADER + len] = (uint8_t)crc;
+    frame[EVENT_FRAME_HEADER + len + 1] = (uint8_t)(crc >> 8);
+
+    return len + EVENT_FRAME_OVERHEAD;
+}
+
+/* ------------------------
+ * EventFrameParser
+ * ------------------------ */
+
+EventFrameParser::EventFrameParser() :
+    _state(STATE_SYNC),
+    _type(0),
+    _length(0),
+    _received(0),
+    _crc(0),
+    _raw_length(0),
+    _pending(0),
+    _errors(0)
+{
+}
+
+void EventFrameParser::reset(void)
+{
+    _state = STATE_SYNC;
+    _raw_length = 0;
+    _pending = 0;
+}
+
+int EventFrameParser::put(uint8_t c)
+{
+    // between frames nothing is kept, only a sync byte matters
+    if (_state == STATE_SYNC) {
+        return step(c);
+    }
+    _raw[_raw_length + _pending] = c;
+    _pending++;
+    return next();
+}
+
+int EventFrameParser::next(void)
+{
+    while (_pending > 0) {
+        uint8_t c = _raw[_raw_length++];
+        _pending--;
+        if (step(c)) {
+            resync(_raw_length);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void EventFrameParser::pass(EventFrameParser *to)
+{
+    if ((to == this) || (_state == STATE_SYNC)) {
+        return;
+    }
+    // after resync() the kept bytes follow a sync byte, parsed or not
+    memcpy(to->_raw, _raw, _raw_length + _pending);
+    to->_pending = _raw_length + _pending;
+    to->_raw_length = 0;
+    to->_crc = 0xFFFF;
+    to->_state = STATE_TYPE;
+    reset();
+}
+
+/* drops the current frame; its bytes after the false sync are scanned again by next() */
+int EventFrameParser::reject(void)
+{
+    _errors++;
+    resync(0);
+    return 0;
+}
+
+/* drops the bytes before from and starts a frame after the next sync byte in the rest */
+void EventFrameParser::resync(int from)
+{
+    int end = _raw_length + _pending;
+
+    while ((from < end) && (_raw[from] != EVENT_FRAME_SYNC)) {
+        from++;
+    }
+    if (from == end) {
+        reset();
+        return;
+    }
+    from++;
+    memmove(_raw, &_raw[from], end - from);
+    _pending = end - from;
+    _raw_length = 0;
+    _crc = 0xFFFF;
+    _state = STATE_TYPE;
+}
+
+int EventFrameParser::step(uint8_t c)
+{
+    switch (_state) {
+        case STATE_SYNC:
+            if (c == EVENT_FRAME_SYNC) {
+                _crc = 0xFFFF;
+                _raw_length = 0;
+                _state = STATE_TYPE;
+            }
+            return 0;
+        case STATE_TYPE:
+            _type = c;
+            _state = STATE_LENGTH_LOW;
+            break;
+        case STATE_LENGTH_LOW:
+            _length = c;
+            _state = STATE_LENGTH_HIGH;
+            break;
+        case STATE_LENGTH_HIGH:
+            _length |= (uint16_t)c << 8;
+            _received = 0;
+            if (_length > EVENT_FRAME_LENGTH_MAX) {
+                return reject();
+            }
+            _state = (_length == 0) ? STATE_CRC_LOW : STATE_PAYLOAD;
+            break;
+        case STATE_PAYLOAD:
+            _payload[_received++] = c;
+            if (_received == _length) {
+                _state = STATE_CRC_LOW;
+            }
+            break;
+        case STATE_CRC_LOW:
+            if (c != (uint8_t)_crc) {
+                return reject();
+            }
+            _state = STATE_CRC_HIGH;
+            return 0;
+        case STATE_CRC_HIGH:
+            if (c != (uint8_t)(_crc >> 8)) {
+                return reject();
+            }
+            _state = STATE_SYNC;
+            return 1;
+    }
+
+    _crc = event_frame_crc(_crc, &c, 1);
+    return 0;
+}
+
+uint8_t EventFrameParser::type(void) const
+{
+    return _type;
+}
+
+const uint8_t *EventFrameParser::payload(void) const
+{
+    return _payload;
+}
+
+int EventFrameParser::length(void) const
+{
+    return _length;
+}
+
+uint32_t EventFrameParser::errors(void) const
+{
+    return _errors;
+}
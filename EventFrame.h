@@ -0,0 +1,137 @@
+/* Binary event frames for USB serial
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef EVENT_FRAME_H_
+#define EVENT_FRAME_H_
+
+#include <stdint.h>
+
+/* --------------------------------
+ * Constant
+ * -------------------------------- */
+
+/* usb-output (USB_OUTPUT) */
+#define USB_OUTPUT_TEXT               0           // UTF-8 lines, as printed
+#define USB_OUTPUT_BINARY             1           // frames with decoded records
+#define USB_OUTPUT_BINARY_RAW         2           // frames with raw history blocks
+
+#define EVENT_FRAME_SYNC              0xA5
+#define EVENT_FRAME_HEADER            4           // sync, type, length
+#define EVENT_FRAME_OVERHEAD          6           // sync, type, length, CRC
+#define EVENT_FRAME_PAYLOAD_MAX       64          // events the reader sends
+#define EVENT_FRAME_LENGTH_MAX        276         // any frame, a passthrough response with 265 bytes from the reader
+
+/* frame types */
+#define EVENT_CARD                    0x01        // card, IDm, balance, name
+#define EVENT_RECORD                  0x02        // history_pack() record
+#define EVENT_RAW                     0x03        // card, raw history block
+#define EVENT_END                     0x04        // end of a tap, record count
+#define EVENT_DROPPED                 0x05        // output lost to a full buffer
+#define EVENT_TIMELINE                0x06        // entries of a tap timeline, see Timeline.h
+#define EVENT_PRINT                   0x07        // print job state
+#define EVENT_PASSTHROUGH             0x08        // reader command from the host, or its response
+#define EVENT_SCAN                    0x09        // card found in the IDm-only scan mode
+#define EVENT_SCAN_STATS              0x0A        // scan mode counters
+#define EVENT_CACHE_STATS             0x0B        // station name cache counters
+
+/* EVENT_CARD payload: card(1) idm(8) balance(4, LE) name(rest, ASCII) */
+#define EVENT_CARD_SIZE               13
+
+/* EVENT_DROPPED payload: dropped bytes(4, LE) overflows(4, LE), both totals since reset */
+#define EVENT_DROPPED_SIZE            8
+
+/* EVENT_PRINT payload: job id(4, LE) state(1, PRINT_JOB_*) spooled bytes(2, LE) */
+#define EVENT_PRINT_SIZE              7
+
+/* EVENT_SCAN payload: card number(4, LE, from 1) time(4, LE, ms since start) idm(8) */
+#define EVENT_SCAN_SIZE               16
+
+/* EVENT_SCAN_STATS payload: time(4) polls(4) hits(4) cards(4) repeats(4), LE, totals since start */
+#define EVENT_SCAN_STATS_SIZE         20
+
+/* EVENT_CACHE_STATS payload: hits(4) misses(4), LE, totals since start */
+#define EVENT_CACHE_STATS_SIZE        8
+
+/* EVENT_PASSTHROUGH request (host): seq(1) op(1) timeout(2, LE, ms, 0 keeps the default) command(rest)
+ * response: seq(1) op(1) status(1) wait(4, LE, us) time(4, LE, us) response(rest)
+ * wait is the time the request was queued on the reader, time the time the command took */
+#define PASSTHROUGH_REQUEST_SIZE      4
+#define PASSTHROUGH_RESPONSE_SIZE     11
+
+/* passthrough ops */
+#define PASSTHROUGH_END               0x00        // leaves passthrough mode
+#define PASSTHROUGH_RW                0x01        // PN533 command to the RC-S620/S (D4 ...), rwCommand()
+#define PASSTHROUGH_CARD              0x02        // FeliCa command without the length byte, cardCommand()
+
+/* passthrough status */
+#define PASSTHROUGH_OK                0
+#define PASSTHROUGH_FAILED            1           // no valid response from the reader or the card
+#define PASSTHROUGH_BAD_REQUEST       2
+
+/*
+ * Frame layout, multi-byte fields little endian:
+ *
+ *   sync     EVENT_FRAME_SYNC
+ *   type     EVENT_*
+ *   length   uint16_t, payload bytes
+ *   payload
+ *   crc      uint16_t, CRC-16/CCITT-FALSE of type, length and payload
+ *
+ * A receiver that loses sync skips to the next sync byte and relies on
+ * the CRC to reject false starts; the bytes of a rejected frame are
+ * scanned again so a real frame right behind a false sync is not lost.
+ * Such a frame may end before the bytes received so far; the rest is
+ * kept and parsed by next() or the following put().
+ */
+
+/* --------------------------------
+ * Class Declaration
+ * -------------------------------- */
+
+/* incremental receiver, also for passthrough requests on the reader */
+class EventFrameParser
+{
+public:
+    EventFrameParser();
+
+    int put(uint8_t c);         // 1 when a complete, valid frame is available
+    int next(void);             // 1 when the bytes kept after the last frame hold another one
+    void pass(EventFrameParser *to);    // hands the bytes after the last frame to an idle parser
+    void reset(void);
+
+    uint8_t type(void) const;
+    const uint8_t *payload(void) const;
+    int length(void) const;
+    uint32_t errors(void) const;
+
+private:
+    int step(uint8_t c);
+    int reject(void);
+    void resync(int from);
+
+    int _state;
+    uint8_t _type;
+    uint16_t _length;
+    uint16_t _received;
+    uint16_t _crc;
+    uint8_t _payload[EVENT_FRAME_LENGTH_MAX];
+    uint8_t _raw[EVENT_FRAME_LENGTH_MAX + EVENT_FRAME_OVERHEAD];    // bytes since sync
+    int _raw_length;                                                // parsed
+    int _pending;                                                   // kept after them, not parsed yet
+    uint32_t _errors;
+};
+
+/* --------------------------------
+ * Function
+ * -------------------------------- */
+
+uint16_t event_frame_crc(uint16_t crc, const uint8_t *data, int len);
+
+/* returns the frame size, or 0 if the payload or the buffer is too large */
+int event_frame_encode(uint8_t type, const uint8_t *payload, int len, uint8_t *frame, int size);
+
+/* frames a payload already at frame + EVENT_FRAME_HEADER, returns the frame size (0 if too large) */
+int event_frame_seal(uint8_t type, uint8_t *frame, int len);
+
+#endif /* !EVENT_FRAME_H_ */
@@ -0,0 +1,91 @@
+/* Typed card history records
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef HISTORY_H_
+#define HISTORY_H_
+
+#include <stdint.h>
+
+/* --------------------------------
+ * Constant
+ * -------------------------------- */
+
+#define HISTORY_BLOCK_SIZE            16
+#define HISTORY_PACKED_SIZE           36          // history_pack() output
+
+/* history_record.card */
+#define HISTORY_CYBERNE               0           // Suica, PASMO and the other transit cards
+#define HISTORY_ECOMYCA               1
+#define HISTORY_EDY                   2
+#define HISTORY_NANACO                3
+#define HISTORY_WAON                  4
+
+/* history_record.flags */
+#define HISTORY_VALID                 0x01        // the block held a record
+#define HISTORY_TIME                  0x02        // hour and minute are set
+#define HISTORY_SECOND                0x04        // second is set
+#define HISTORY_END_TIME              0x08        // end_hour and end_minute are set
+#define HISTORY_AMOUNT                0x10        // amount is set
+#define HISTORY_CHARGE                0x20        // charge is set
+#define HISTORY_SEQUENCE              0x40        // sequence is set
+
+/* --------------------------------
+ * Structure
+ * -------------------------------- */
+
+/*
+ * One history entry with every field decoded, but nothing looked up:
+ * stations stay codes until a renderer asks the station database for
+ * their names. Fields a card does not have are zero.
+ */
+struct history_record {
+    uint32_t balance;
+    int32_t amount;             // amount of the transaction, or the change of the balance
+    uint32_t charge;            // WAON: charged amount
+    uint16_t year;
+    uint16_t sequence;
+    uint8_t card;
+    uint8_t flags;
+    uint8_t terminal;           // terminal (machine) type
+    uint8_t process;            // process type
+    uint8_t gate;               // Suica: entry/exit type
+    uint8_t payment;            // Suica: payment type
+    uint8_t month;
+    uint8_t day;
+    uint8_t hour;
+    uint8_t minute;
+    uint8_t second;
+    uint8_t end_hour;           // ecomyca: second time of the record
+    uint8_t end_minute;
+    uint8_t region_in;          // Suica: stations, or bus operator and stop
+    uint8_t line_in;
+    uint8_t station_in;
+    uint8_t region_out;
+    uint8_t line_out;
+    uint8_t station_out;
+};
+
+/* --------------------------------
+ * Function
+ * -------------------------------- */
+
+/* every decoder returns 1 and sets HISTORY_VALID, or 0 for an empty block */
+int history_decode_cyberne(const uint8_t *block, history_record *rec);
+int history_decode_ecomyca(const uint8_t *block, history_record *rec);
+int history_decode_edy(const uint8_t *block, history_record *rec);
+int history_decode_nanaco(const uint8_t *block, history_record *rec);
+int history_decode_waon(const uint8_t *head, const uint8_t *body, history_record *rec);
+
+/*
+ * Decodes count blocks (newest first, as the card stores them) into
+ * records[], one record per block. Returns the number of valid records.
+ * For transit cards the amount is derived from the next older balance.
+ */
+int history_decode_batch(int card, const uint8_t (*blocks)[HISTORY_BLOCK_SIZE], int count, history_record *records);
+
+/* binary rendering, little endian; both return HISTORY_PACKED_SIZE or 0 */
+int history_pack(const history_record *rec, uint8_t *buf, int size);
+int history_unpack(const uint8_t *buf, int size, history_record *rec);
+
+#endif /* !HISTORY_H_ */
@@ -0,0 +1,648 @@
+/* Receipt text of decoded history records
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stddef.h>
+
+#include "HistoryRender.h"
+
+/* --------------------------------
+ * Function
+ * -------------------------------- */
+
+HistoryRender::HistoryRender(ReceiptOutput &receipt, ReceiptSink &serial, ReceiptSink &printer,
+                             StationDBSlot &stations, Timeline &timeline) :
+    _receipt(receipt),
+    _serial(serial),
+    _printer(printer),
+    _stations(stations),
+    _timeline(timeline)
+#if PRINTER_SJIS
+    , _printer_db(NULL)
+#endif
+{
+}
+
+#if PRINTER_SJIS
+void HistoryRender::setPrinterDB(StationDB *db)
+{
+    _printer_db = db;
+    _printer_cache.clear();
+}
+#endif
+
+void HistoryRender::cyberne(const history_record *rec)
+{
+    TIMELINE_SCOPE(_timeline, TIMELINE_FORMAT);
+    ReceiptLine line;
+    int region_in, region_out, line_in, line_out, station_in, station_out;
+
+    region_in = rec->region_in;
+    region_out = rec->region_out;
+    line_in = rec->line_in;
+    station_in = rec->station_in;
+    line_out = rec->line_out;
+    station_out = rec->station_out;
+
+    line.add("機種種別: ");
+    switch (rec->terminal) {
+        case 0x03:
+            line.add("のりこし精算機\r");
+            break;
+        case 0x04:
+            line.add("携帯型端末\r");
+            break;
+        case 0x05:
+            line.add("バス/路面等\r");
+            break;
+        case 0x09:
+            line.add("入金機\r");
+            break;
+        case 0x07:
+        case 0x08:
+        case 0x12:
+            line.add("券売機\r");
+            break;
+        case 0x14:
+        case 0x15:
+            line.add("券売機等\r");
+            break;
+        case 0x16:
+            line.add("自動改札機\r");
+            break;
+        case 0x17:
+            line.add("簡易改札機\r");
+            break;
+        case 0x18:
+        case 0x19:
+            line.add("窓口端末\r");
+            break;
+        case 0x1A:
+            line.add("改札端末\r");
+            break;
+        case 0x1B:
+            line.add("モバイルFeliCa\r");
+            break;
+        case 0x1C:
+            line.add("乗継精算機\r");
+            break;
+        case 0x1D:
+            line.add("連絡改札機\r");
+            break;
+        case 0x1F:
+            line.add("簡易入金機\r");
+            break;
+        case 0x22:
+            line.add("窓口処理機\r");
+            break;
+        case 0x23:
+            line.add("乗継精算機\r");
+            break;
+        case 0x46:
+        case 0x48:
+            line.add("ビューアルッテ端末\r");
+            break;
+        case 0xc7:
+        case 0xc9:
+            line.add("物販端末\r");
+            break;
+        case 0xc8:
+            line.add("自販機\r");
+            break;
+        default:
+            line.add("不明\r");
+            break;
+    }
+    _serial.write(line);
+    //_printer.write(line);
+
+    int hasStationName = 0;
+    line.clear();
+    line.format(LABEL_USE_TYPE);
+    switch (rec->process) {
+        case 0x01:
+            line.format(LABEL_GATE_EXIT);
+            break;
+        case 0x02:
+            line.format(LABEL_SF_CHARGE);
+            hasStationName = 1;
+            break;
+        case 0x03:
+            line.format(LABEL_TICKET);
+            hasStationName = 1;
+            break;
+        case 0x04:
+            line.format(LABEL_MAGNETIC_FARE);
+            break;
+        case 0x05:
+            line.format(LABEL_EXCESS_FARE);
+            break;
+        case 0x06:
+            line.format(LABEL_WINDOW_FARE);
+            break;
+        case 0x07:
+            line.format(LABEL_NEW);
+            if (line_in == 0 && station_in == 0) {
+                hasStationName = 0;
+            }
+            else {
+                line.add('\r');
+                hasStationName = 1;
+            }
+            break;
+        case 0x08:
+            line.format(LABEL_CHARGE_DEDUCT);
+            break;
+        case 0x0C:
+        case 0x0D:
+        case 0x0F:
+            line.format(LABEL_BUS);
+            busName(&line, ((line_in << 8) | station_in), ((line_out << 8) | station_out));
+            break;
+        case 0x13:
+            line.format(LABEL_SHINKANSEN);
+            hasStationName = 2;
+            break;
+        case 0x14:
+        case 0x15:
+            line.format(LABEL_AUTO_CHARGE);
+            break;
+        case 0x46:
+            line.format(LABEL_SALE);
+            break;
+        case 0xc6:
+            line.format(LABEL_CASH_SALE);
+            break;
+        default:
+            line.format(LABEL_UNKNOWN);
+            break;
+    }
+    if (hasStationName >= 1) {
+        if (stationName(&line, region_in, line_in, station_in) != 0) {
+            busName(&line, ((line_in << 8) | station_in), ((line_out << 8) | station_out));
+        }
+    }
+    if (hasStationName == 2) {
+        line.add(" - ");
+        stationName(&line, region_out, line_out, station_out);
+    }
+    line.newline();
+    _receipt.write(line);
+
+#if 0
+    if (rec->payment != 0) {
+        line.clear();
+        line.add("支払種別: ");
+        switch (rec->payment) {
+            case 0x02:
+                line.add("VIEW\r");
+                break;
+            case 0x0B:
+                line.add("PiTaPa\r");
+                break;
+            case 0x0d:
+                line.add("オートチャージ対応PASMO\r");
+                break;
+            case 0x3f:
+                line.add("モバイルSuica\r");
+                break;
+            default:
+                line.add("不明\r");
+                break;
+        }
+        _receipt.write(line);
+    }
+#endif
+
+    hasStationName = 0;
+    if (rec->process == 0x01 || rec->process == 0x14) {
+        line.clear();
+        line.format(LABEL_GATE_TYPE);
+        switch (rec->gate) {
+            case 0x01:
+            case 0x08:
+                line.format(LABEL_ENTRY);
+                hasStationName = 1;
+                break;
+            case 0x02:
+                line.format(LABEL_EXIT);
+                hasStationName = 2;
+                break;
+            case 0x03:
+                line.format(LABEL_PASS_ENTRY);
+                hasStationName = 1;
+                break;
+            case 0x04:
+                line.format(LABEL_PASS_EXIT);
+                hasStationName = 2;
+                break;
+            case 0x05:
+                line.format(LABEL_ENTRY_TRANSFER);
+                hasStationName = 2;
+                break;
+            case 0x0E:
+                line.format(LABEL_WINDOW_EXIT);
+                break;
+            case 0x0F:
+                line.format(LABEL_BUS_GATE);
+                break;
+            case 0x12:
+                line.format(LABEL_FEE_PASS);
+                break;
+            case 0x17:
+            case 0x1D:
+                line.format(LABEL_TRANSFER_DISCOUNT);
+                hasStationName = 2;
+                break;
+            case 0x21:
+                line.format(LABEL_BUS_TRANSFER_DISCOUNT);
+                break;
+            case 0x22:
+            case 0x25:
+            case 0x26:
+                line.format(LABEL_OFF_ROUTE);
+                hasStationName = 2;
+                break;
+            default:
+                line.format(LABEL_UNKNOWN);
+                line.add(' ');
+                line.hex(line_in, 2, true);
+                line.add(' ');
+                line.hex(station_in, 2, true);
+                line.add(' ');
+                line.hex(line_out, 2, true);
+                line.add(' ');
+                line.hex(station_out, 2, true);
+                break;
+        }
+        if (hasStationName >= 1) {
+            stationName(&line, region_in, line_in, station_in);
+        }
+        if (hasStationName == 2) {
+            line.add(" - ");
+            stationName(&line, region_out, line_out, station_out);
+        }
+        line.newline();
+        _receipt.write(line);
+    }
+
+    line.clear();
+    line.format(LABEL_PROCESS_DATE);
+    line.dec(rec->year);
+    line.add('/');
+    line.dec(rec->month, 2, '0');
+    line.add('/');
+    line.dec(rec->day, 2, '0');
+    if (rec->flags & HISTORY_TIME) {   // sales
+        line.add(' ');
+        line.dec(rec->hour, 2, '0');
+        line.add(':');
+        line.dec(rec->minute, 2, '0');
+        line.add(':');
+        line.dec(rec->second, 2, '0');
+    }
+    line.newline();
+    _receipt.write(line);
+
+    line.clear();
+    line.format(LABEL_REMAIN);
+    line.yen((long)rec->balance);
+    line.newline();
+    _serial.write(line);
+    line.newline();
+    _printer.doubleWidth(true);
+    _printer.write(line);
+    _printer.doubleWidth(false);
+}
+
+void HistoryRender::nanaco(const history_record *rec)
+{
+    TIMELINE_SCOPE(_timeline, TIMELINE_FORMAT);
+    ReceiptLine line;
+
+    line.format(LABEL_KIND);
+    if (rec->process == 0x35) {
+        line.format(LABEL_TAKEOVER);
+    }
+    if (rec->process == 0x47) {
+        line.format(LABEL_PAYMENT);
+    }
+    if (rec->process == 0x6F || rec->process == 0x70) {
+        line.format(LABEL_CHARGE);
+    }
+    if (rec->process == 0x77) {
+        line.format(LABEL_AUTO_CHARGE);
+    }
+    if (rec->process == 0x7A) {
+        line.format(LABEL_NEW);
+    }
+    if (rec->process == 0x83) {
+        line.format(LABEL_POINT_CHARGE);
+    }
+    line.newline();
+    _receipt.write(line);
+    
+    line.clear();
+    line.format(LABEL_DATE);
+    line.date(rec->year, rec->month, rec->day, 2, '0');
+    line.add(' ');
+    line.time(rec->hour, rec->minute);
+    line.newline();
+    _receipt.write(line);
+
+    line.clear();
+    line.format(LABEL_NANACO_AMOUNT);
+    line.yen((long)rec->amount);
+    line.newline();
+    _receipt.write(line);
+
+    line.clear();
+    line.format(LABEL_BALANCE);
+    line.yen((long)rec->balance);
+    line.newline();
+    _receipt.write(line);
+}
+
+void HistoryRender::waon(const history_record *rec, const uint8_t *head)
+{
+    ReceiptLine line;
+
+    line.add("------");
+    line.newline();
+    _serial.write(line);
+    line.clear();
+    line.format(LABEL_TERMINAL);
+    for (int ch = 0; ch <= 12; ch++) {
+        line.add((char)head[ch]);
+    }
+    line.add(" (");
+    line.dec(rec->sequence);
+    line.add(')');
+    line.newline();
+    _receipt.write(line);
+
+    line.clear();
+    line.format(LABEL_KIND);
+    switch (rec->process) {
+        case 0x04:
+            line.format(LABEL_PAYMENT);
+            break;
+        case 0x08:
+            line.format(LABEL_RETURN);
+            break;
+        case 0x0C:
+            line.format(LABEL_CASH_CHARGE);
+            break;
+        case 0x10:
+            line.format(LABEL_CHARGE);
+            break;
+        case 0x18:
+            line.format(LABEL_POINT_DOWNLOAD);
+            break;
+        case 0x28:
+            line.format(LABEL_REFUND);
+            break;
+        case 0x1C:
+        case 0x20:
+            line.format(LABEL_PURCHASE_AUTO_CHARGE);
+            break;
+        case 0x30:
+            line.format(LABEL_BANK_AUTO_CHARGE);
+            break;
+        case 0x3C:
+            line.format(LABEL_CARD_MIGRATION);
+            break;
+        case 0x7C:
+            line.format(LABEL_POINT_EXCHANGE);
+            break;
+    }
+    line.newline();
+    _receipt.write(line);
+
+    line.clear();
+    line.format(LABEL_DATE);
+    line.date(rec->year, rec->month, rec->day, 2);
+    line.add(' ');
+    line.time(rec->hour, rec->minute);
+    line.add('\r');
+    _receipt.write(line);
+
+    if (rec->flags & HISTORY_AMOUNT) {
+        line.clear();
+        line.format(LABEL_USED_AMOUNT);
+        line.yen((long)rec->amount);
+        line.newline();
+        _receipt.write(line);
+    }
+
+    if (rec->flags & HISTORY_CHARGE) {
+        line.clear();
+        line.format(LABEL_CHARGE_AMOUNT);
+        line.yen((long)rec->charge);
+        line.newline();
+        _receipt.write(line);
+    }
+
+    line.clear();
+    line.format(LABEL_BALANCE);
+    line.yen((long)rec->balance);
+    line.newline();
+    _serial.write(line);
+    line.newline();
+    _printer.write(line);
+}
+
+void HistoryRender::edy(const history_record *rec)
+{
+    TIMELINE_SCOPE(_timeline, TIMELINE_FORMAT);
+    ReceiptLine line;
+
+    line.add("-----");
+    line.newline();
+    _serial.write(line);
+    line.clear();
+    line.newline();
+    _printer.write(line);
+
+    line.clear();
+    line.format(LABEL_KIND);
+    switch (rec->process) {
+        case 0x02:
+            line.format(LABEL_CHARGE);
+            break;
+        case 0x04:
+            line.format(LABEL_VALUE_CHARGE);
+            break;
+        case 0x20:
+            line.format(LABEL_PAYMENT);
+            break;
+        default:
+            line.format(LABEL_UNKNOWN);
+            line.add('(');
+            line.dec((rec->balance >> 24) & 0xFF);
+            line.add(')');
+            break;
+    }
+    line.add(' ');
+    line.newline();
+    _receipt.write(line);
+    
+    line.clear();
+    line.format(LABEL_USE_DATE);
+    line.date(rec->year, rec->month, rec->day);
+    line.add(' ');
+    line.time(rec->hour, rec->minute);
+    line.newline();
+    _receipt.write(line);
+
+    line.clear();
+    line.format(LABEL_USED_AMOUNT);
+    line.yen((long)rec->amount);
+    line.newline();
+    _receipt.write(line);
+    
+    line.clear();
+    line.format(LABEL_BALANCE);
+    line.yen((long)rec->balance);
+    line.newline();
+    _serial.write(line);
+    line.newline();
+    _printer.write(line);
+}
+
+void HistoryRender::ecomyca(const history_record *rec)
+{
+    TIMELINE_SCOPE(_timeline, TIMELINE_FORMAT);
+    ReceiptLine line;
+
+    line.add("機種種別: ");
+    switch (rec->terminal) {
+        case 0x20:
+            line.add("鉄道\r");
+            break;
+        case 0x70:
+            line.add("窓口精算機\r");
+            break;
+        case 0x90:
+            line.add("運賃箱カードリーダー\r");
+            break;
+        default:
+            line.add("不明\r");
+            break;
+    }
+    _serial.write(line);
+
+    line.clear();
+    line.format(LABEL_PROCESS);
+    switch (rec->process) {
+        case 0x00:
+            line.format(LABEL_NEW);
+            break;
+        case 0x02:
+            line.format(LABEL_PAYMENT);
+            break;
+        default:
+            line.format(LABEL_UNKNOWN);
+            break;
+    }
+    line.newline();
+    _receipt.write(line);
+
+    line.clear();
+    line.format(LABEL_PROCESS_DATE);
+    line.dec(rec->year);
+    line.add('/');
+    line.dec(rec->month, 2, '0');
+    line.add('/');
+    line.dec(rec->day, 2, '0');
+    line.add(' ');
+    line.time(rec->hour, rec->minute);
+    line.add(' ');
+    line.time(rec->end_hour, rec->end_minute);
+    line.newline();
+    _receipt.write(line);
+
+    line.clear();
+    line.add("利用金額: ");
+    line.dec(rec->amount);
+    line.add("円");
+    line.newline();
+    _serial.write(line);
+    line.clear();
+    line.format(LABEL_REMAIN);
+    line.yen((long)rec->balance);
+    line.newline();
+    _serial.write(line);
+    line.newline();
+    _printer.doubleWidth(true);
+    _printer.write(line);
+    _printer.doubleWidth(false);
+}
+
+/* ------------------------
+ * station names
+ * ------------------------ */
+
+int HistoryRender::stationName(ReceiptLine *out, int area, int line, int station)
+{
+    TIMELINE_SCOPE(_timeline, TIMELINE_STATION);
+    const char *line_name;
+    const char *name;
+    int ret = -1;
+    StationDB *db = _stations.lock();
+    if (_cache.find(db, _stations.generation(), area, line, station, &line_name, &name)) {
+        const char *print_line_name = line_name;
+        const char *print_name = name;
+        const char *print_line = label_print(LABEL_LINE);
+        const char *print_station = label_print(LABEL_STATION);
+#if PRINTER_SJIS
+        // the printer copy takes the Shift_JIS names, or prints the station as unknown
+        if ((_printer_db == NULL) ||
+            !_printer_cache.find(_printer_db, 0, area, line, station, &print_line_name, &print_name)) {
+            print_line_name = label_print(LABEL_UNKNOWN);
+            print_name = print_line = print_station = "";
+        }
+#endif
+        out->append(line_name, print_line_name);
+        out->append(label_text(LABEL_LINE), print_line);
+        out->append(name, print_name);
+        out->append(label_text(LABEL_STATION), print_station);
+        ret = 0;
+    }
+    _stations.unlock();
+    return ret;
+}
+
+void HistoryRender::busName(ReceiptLine *out, int code, int stop)
+{
+    TIMELINE_SCOPE(_timeline, TIMELINE_STATION);
+    const char *line_name;
+    const char *name;
+    StationDB *db = _stations.lock();
+    if (_cache.findBus(db, _stations.generation(), code, stop, &line_name, &name)) {
+        const char *print_line_name = line_name;
+        const char *print_name = name;
+#if PRINTER_SJIS
+        if ((_printer_db == NULL) ||
+            !_printer_cache.findBus(_printer_db, 0, code, stop, &print_line_name, &print_name)) {
+            print_line_name = label_print(LABEL_UNKNOWN);
+            print_name = "";
+        }
+#endif
+        out->append(line_name, print_line_name);
+        if (name[0] != '\0') {
+            // followed by the stop when it is known
+            out->add(' ');
+            out->append(name, print_name);
+        }
+    }
+    else {
+        out->format(LABEL_UNKNOWN);
+    }
+    _stations.unlock();
+}
+
+const StationCache &HistoryRender::cache(void) const
+{
+    return _cache;
+}
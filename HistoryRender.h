@@ -0,0 +1,66 @@
+/* Receipt text of decoded history records
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef HISTORY_RENDER_H_
+#define HISTORY_RENDER_H_
+
+#include <stdint.h>
+
+#include "History.h"
+#include "ReceiptLine.h"
+#include "StationDB.h"
+#include "StationDBFile.h"
+#include "StationCache.h"
+#include "Timeline.h"
+
+/* --------------------------------
+ * Class Declaration
+ * -------------------------------- */
+
+/*
+ * Turns history records into receipt lines. Most lines go to every sink
+ * of the ReceiptOutput; the terminal type and a few repeated lines only
+ * to the serial sink or only to the printer sink, as they always did.
+ * Station and bus stop codes are looked up here, through a cache, when a
+ * line needs their names; with PRINTER_SJIS the printer copy takes its
+ * names from the Shift_JIS database given to setPrinterDB().
+ *
+ * Nothing here touches the hardware, so tools/bench-history checks the
+ * text against tools/history_corpus.txt on the host.
+ */
+class HistoryRender
+{
+public:
+    HistoryRender(ReceiptOutput &receipt, ReceiptSink &serial, ReceiptSink &printer,
+                  StationDBSlot &stations, Timeline &timeline);
+
+#if PRINTER_SJIS
+    void setPrinterDB(StationDB *db);
+#endif
+
+    void cyberne(const history_record *rec);
+    void nanaco(const history_record *rec);
+    void waon(const history_record *rec, const uint8_t *head);  // head: terminal and sequence block
+    void edy(const history_record *rec);
+    void ecomyca(const history_record *rec);
+
+    int stationName(ReceiptLine *out, int area, int line, int station);    // 0 when found
+    void busName(ReceiptLine *out, int code, int stop);
+
+    const StationCache &cache(void) const;
+
+private:
+    ReceiptOutput &_receipt;
+    ReceiptSink &_serial;
+    ReceiptSink &_printer;
+    StationDBSlot &_stations;
+    Timeline &_timeline;
+    StationCache _cache;
+#if PRINTER_SJIS
+    StationDB *_printer_db;
+    StationCache _printer_cache;
+#endif
+};
+
+#endif /* !HISTORY_RENDER_H_ */
@@ -0,0 +1,40 @@
+/* IDm-only card scanning
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+
+#include "IdmScanner.h"
+
+/* --------------------------------
+ * Function
+ * -------------------------------- */
+
+IdmScanner::IdmScanner(uint32_t window) :
+    _recent(window)
+{
+    memset(&_counters, 0, sizeof(_counters));
+}
+
+int IdmScanner::found(const uint8_t *idm, uint32_t now)
+{
+    _counters.polls++;
+    _counters.hits++;
+    if (_recent.seen(idm, now)) {
+        _counters.repeats++;
+        return 0;
+    }
+    _recent.insert(idm, now);
+    _counters.cards++;
+    return 1;
+}
+
+void IdmScanner::missed(void)
+{
+    _counters.polls++;
+}
+
+const scan_counters &IdmScanner::counters(void) const
+{
+    return _counters;
+}
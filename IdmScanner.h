@@ -0,0 +1,58 @@
+/* IDm-only card scanning
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef IDM_SCANNER_H_
+#define IDM_SCANNER_H_
+
+#include <stdint.h>
+
+#include "IdmSet.h"
+
+/* --------------------------------
+ * Constant
+ * -------------------------------- */
+
+/* time (ms) a card is not reported again after it was last seen (scan-window) */
+#ifndef SCAN_WINDOW
+#define SCAN_WINDOW                   3000
+#endif
+
+/* --------------------------------
+ * Structure
+ * -------------------------------- */
+
+/* totals since start */
+struct scan_counters {
+    uint32_t polls;             // polling commands
+    uint32_t hits;              // polls that found a card
+    uint32_t cards;             // cards reported
+    uint32_t repeats;           // hits on a card still within its window
+};
+
+/* --------------------------------
+ * Class Declaration
+ * -------------------------------- */
+
+/*
+ * Decides which polled IDms are reported in the IDm-only scan mode. A
+ * card is reported when it has not been seen for the window; every hit
+ * restarts its window, so a card left on the reader is reported once.
+ * The cards within their window are kept in an IdmSet. Times are the
+ * caller's millisecond clock.
+ */
+class IdmScanner
+{
+public:
+    IdmScanner(uint32_t window = SCAN_WINDOW);
+
+    int found(const uint8_t *idm, uint32_t now);    // 1 when the card is to be reported
+    void missed(void);                              // a poll without a card
+    const scan_counters &counters(void) const;
+
+private:
+    IdmSet _recent;
+    scan_counters _counters;
+};
+
+#endif /* !IDM_SCANNER_H_ */
@@ -0,0 +1,119 @@
+/* Time-windowed set of recently read IDms
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+
+#include "IdmSet.h"
+
+static_assert((IDM_SET_SIZE & (IDM_SET_SIZE - 1)) == 0, "IDM_SET_SIZE must be a power of two");
+
+/* --------------------------------
+ * Function
+ * -------------------------------- */
+
+/* FNV-1a; the first bytes of an IDm are the manufacturer, so all of them are mixed */
+static uint32_t idm_hash(const uint8_t *idm)
+{
+    uint32_t h = 2166136261UL;
+
+    for (int i = 0; i < 8; i++) {
+        h = (h ^ idm[i]) * 16777619UL;
+    }
+    return h;
+}
+
+IdmSet::IdmSet(uint32_t ttl) :
+    _ttl(ttl)
+{
+    clear();
+}
+
+void IdmSet::clear(void)
+{
+    memset(_slots, 0, sizeof(_slots));
+    _used = 0;
+}
+
+int IdmSet::seen(const uint8_t *idm, uint32_t now)
+{
+    int i = find(idm);
+
+    if ((i < 0) || ((now - _slots[i].seen) >= _ttl)) {
+        return 0;
+    }
+    _slots[i].seen = now;
+    return 1;
+}
+
+void IdmSet::insert(const uint8_t *idm, uint32_t now)
+{
+    int i = find(idm);
+
+    if (i >= 0) {
+        _slots[i].seen = now;
+        return;
+    }
+    if (_used >= IDM_SET_LIMIT) {
+        rebuild(now);
+    }
+
+    i = idm_hash(idm) & (IDM_SET_SIZE - 1);
+    while (_slots[i].used) {
+        i = (i + 1) & (IDM_SET_SIZE - 1);
+    }
+    memcpy(_slots[i].idm, idm, 8);
+    _slots[i].seen = now;
+    _slots[i].used = 1;
+    _used++;
+}
+
+/* ------------------------
+ * local
+ * ------------------------ */
+
+int IdmSet::find(const uint8_t *idm) const
+{
+    int i = idm_hash(idm) & (IDM_SET_SIZE - 1);
+
+    // the table never fills, so an unused slot ends every probe
+    while (_slots[i].used) {
+        if (memcmp(_slots[i].idm, idm, 8) == 0) {
+            return i;
+        }
+        i = (i + 1) & (IDM_SET_SIZE - 1);
+    }
+    return -1;
+}
+
+/* drops the expired entries, and the one seen longest ago if no slot was freed */
+void IdmSet::rebuild(uint32_t now)
+{
+    idm_slot live[IDM_SET_SIZE];
+    int count = 0;
+    int oldest = -1;
+
+    for (int i = 0; i < IDM_SET_SIZE; i++) {
+        if (!_slots[i].used || ((now - _slots[i].seen) >= _ttl)) {
+            continue;
+        }
+        live[count] = _slots[i];
+        if ((oldest < 0) || ((now - live[count].seen) > (now - live[oldest].seen))) {
+            oldest = count;
+        }
+        count++;
+    }
+    if (count >= IDM_SET_LIMIT) {
+        live[oldest] = live[--count];
+    }
+
+    clear();
+    for (int n = 0; n < count; n++) {
+        int i = idm_hash(live[n].idm) & (IDM_SET_SIZE - 1);
+        while (_slots[i].used) {
+            i = (i + 1) & (IDM_SET_SIZE - 1);
+        }
+        _slots[i] = live[n];
+        _used++;
+    }
+}
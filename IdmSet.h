@@ -0,0 +1,58 @@
+/* Time-windowed set of recently read IDms
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef IDM_SET_H_
+#define IDM_SET_H_
+
+#include <stdint.h>
+
+/* --------------------------------
+ * Constant
+ * -------------------------------- */
+
+/* time (ms) a read card is skipped after it was last seen (card-ttl) */
+#ifndef CARD_TTL
+#define CARD_TTL                      5000
+#endif
+
+#define IDM_SET_SIZE                  32          // slots, a power of two
+#define IDM_SET_LIMIT                 (IDM_SET_SIZE * 3 / 4)    // cards kept, the rest keeps probes short
+
+/* --------------------------------
+ * Class Declaration
+ * -------------------------------- */
+
+/*
+ * Open addressing hash set of IDms, each with the time it was last seen.
+ * An entry lives for the TTL after it was last seen, so a card left on
+ * the reader stays in the set and a card taken away can be read again
+ * once the TTL has passed. Expired entries are reused by a rebuild when
+ * the table fills up; with IDM_SET_LIMIT cards in their TTL the one seen
+ * longest ago is forgotten. Times are the caller's millisecond clock.
+ */
+class IdmSet
+{
+public:
+    IdmSet(uint32_t ttl = CARD_TTL);
+
+    int seen(const uint8_t *idm, uint32_t now);     // 1 when the card is in its TTL, which restarts
+    void insert(const uint8_t *idm, uint32_t now);
+    void clear(void);
+
+private:
+    struct idm_slot {
+        uint8_t idm[8];
+        uint32_t seen;
+        uint8_t used;
+    };
+
+    int find(const uint8_t *idm) const;
+    void rebuild(uint32_t now);
+
+    uint32_t _ttl;
+    idm_slot _slots[IDM_SET_SIZE];
+    int _used;                                  // slots in use, expired ones included
+};
+
+#endif /* !IDM_SET_H_ */
@@ -0,0 +1,46 @@
+/* Fixed strings of the history output
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "Labels.h"
+
+#if PRINTER_SJIS
+#if STATION_DB_GENERATED
+#include <labels_sjis.h>    // generated from Labels.h (CMakeLists.txt)
+#else
+#include "labels_sjis.h"
+#endif
+#endif
+
+/* --------------------------------
+ * Constant
+ * -------------------------------- */
+
+static const char *const labels_utf8[] = {
+#define LABEL_TEXT(id, text)  text,
+    LABEL_LIST(LABEL_TEXT)
+#undef LABEL_TEXT
+};
+
+#if PRINTER_SJIS
+static_assert(sizeof(labels_sjis) / sizeof(labels_sjis[0]) == LABEL_COUNT,
+              "labels_sjis.h does not match Labels.h, regenerate it with tools/printer-labels");
+#endif
+
+/* --------------------------------
+ * Function
+ * -------------------------------- */
+
+const char *label_text(label_id id)
+{
+    return labels_utf8[id];
+}
+
+const char *label_print(label_id id)
+{
+#if PRINTER_SJIS
+    return labels_sjis[id];
+#else
+    return labels_utf8[id];
+#endif
+}
@@ -0,0 +1,100 @@
+/* Fixed strings of the history output
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef LABELS_H_
+#define LABELS_H_
+
+/* --------------------------------
+ * Constant
+ * -------------------------------- */
+
+/*
+ * Every non-ASCII string that is sent to the printer. Labels are fixed
+ * text; numbers go between them through ReceiptLine::dec() and hex().
+ * tools/printer-labels reads this list to generate labels_sjis.h, so keep
+ * one X() entry with a single string literal per line.
+ */
+#define LABEL_LIST(X) \
+    X(LABEL_UNKNOWN,                "不明") \
+    X(LABEL_LINE,                   "線 ") \
+    X(LABEL_STATION,                "駅") \
+    X(LABEL_KIND,                   "種別: ") \
+    X(LABEL_NEW,                    "新規") \
+    X(LABEL_PAYMENT,                "支払い") \
+    X(LABEL_CHARGE,                 "チャージ") \
+    X(LABEL_AUTO_CHARGE,            "オートチャージ") \
+    X(LABEL_BALANCE,                "残高: ") \
+    X(LABEL_BALANCE_TOTAL,          "残高 ") \
+    X(LABEL_REMAIN,                 "残額: ") \
+    X(LABEL_USED_AMOUNT,            "利用額: ") \
+    X(LABEL_YEN,                    "円") \
+    X(LABEL_PROCESS_DATE,           "処理日付: ") \
+    X(LABEL_DATE,                   "日時: ") \
+    X(LABEL_YEAR,                   "年") \
+    X(LABEL_MONTH,                  "月") \
+    X(LABEL_DAY,                    "日") \
+    /* Suica */ \
+    X(LABEL_USE_TYPE,               "利用種別: ") \
+    X(LABEL_GATE_EXIT,              "自動改札出場") \
+    X(LABEL_SF_CHARGE,              "SFチャージ\r") \
+    X(LABEL_TICKET,                 "きっぷ購入\r") \
+    X(LABEL_MAGNETIC_FARE,          "磁気券精算") \
+    X(LABEL_EXCESS_FARE,            "乗越精算") \
+    X(LABEL_WINDOW_FARE,            "窓口精算") \
+    X(LABEL_CHARGE_DEDUCT,          "チャージ控除") \
+    X(LABEL_BUS,                    "バス/路面等\r") \
+    X(LABEL_SHINKANSEN,             "支払い（新幹線利用）\r") \
+    X(LABEL_SALE,                   "物販") \
+    X(LABEL_CASH_SALE,              "現金併用物販") \
+    X(LABEL_GATE_TYPE,              "入出場種別: ") \
+    X(LABEL_ENTRY,                  "入場\r") \
+    X(LABEL_EXIT,                   "出場\r") \
+    X(LABEL_PASS_ENTRY,             "定期入場\r") \
+    X(LABEL_PASS_EXIT,              "定期出場\r") \
+    X(LABEL_ENTRY_TRANSFER,         "入場乗継\r") \
+    X(LABEL_WINDOW_EXIT,            "窓口出場") \
+    X(LABEL_BUS_GATE,               "バス入出場") \
+    X(LABEL_FEE_PASS,               "料金定期") \
+    X(LABEL_TRANSFER_DISCOUNT,      "乗継割引\r") \
+    X(LABEL_BUS_TRANSFER_DISCOUNT,  "バス等乗継割引") \
+    X(LABEL_OFF_ROUTE,              "券面外乗降\r") \
+    /* nanaco */ \
+    X(LABEL_NANACO_POINT,           "nanacoポイント: ") \
+    X(LABEL_TAKEOVER,               "引継") \
+    X(LABEL_POINT_CHARGE,           "ポイント交換チャージ") \
+    X(LABEL_NANACO_AMOUNT,          "取扱金額: ") \
+    /* WAON */ \
+    X(LABEL_TERMINAL,               "端末番号: ") \
+    X(LABEL_RETURN,                 "返品") \
+    X(LABEL_CASH_CHARGE,            "チャージ(現金、ポイントチャージ)") \
+    X(LABEL_POINT_DOWNLOAD,         "ポイントダウンロード") \
+    X(LABEL_REFUND,                 "返金") \
+    X(LABEL_PURCHASE_AUTO_CHARGE,   "購入時にオートチャージ") \
+    X(LABEL_BANK_AUTO_CHARGE,       "オートチャージ(銀行)") \
+    X(LABEL_CARD_MIGRATION,         "新カードへの移行") \
+    X(LABEL_POINT_EXCHANGE,         "ポイント交換(預入)") \
+    X(LABEL_CHARGE_AMOUNT,          "チャージ額: ") \
+    X(LABEL_POINT_BALANCE,          " ポイント残高 ") \
+    /* Edy */ \
+    X(LABEL_ISSUE_DATE,             "発行日: ") \
+    X(LABEL_VALUE_CHARGE,           "バリューチャージ") \
+    X(LABEL_USE_DATE,               "利用日時: ") \
+    /* ecomyca */ \
+    X(LABEL_PROCESS,                "処理内容: ")
+
+enum label_id {
+#define LABEL_ID(id, text)  id,
+    LABEL_LIST(LABEL_ID)
+#undef LABEL_ID
+    LABEL_COUNT
+};
+
+/* --------------------------------
+ * Function
+ * -------------------------------- */
+
+const char *label_text(label_id id);        // UTF-8, for USB serial
+const char *label_print(label_id id);       // printer encoding (PRINTER_SJIS)
+
+#endif /* !LABELS_H_ */
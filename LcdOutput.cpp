@@ -0,0 +1,127 @@
+/* Shadowed, differential character LCD output
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "LcdOutput.h"
+
+/* --------------------------------
+ * Constant
+ * -------------------------------- */
+
+#define LCD_FLAG_UPDATE               0x01
+
+#if MBED_CONF_RTOS_PRESENT
+#define LCD_LOCK()                    _mutex.lock()
+#define LCD_UNLOCK()                  _mutex.unlock()
+#else
+#define LCD_LOCK()
+#define LCD_UNLOCK()
+#endif
+
+/* --------------------------------
+ * Function
+ * -------------------------------- */
+
+LcdOutput::LcdOutput(SB1602E &lcd) :
+    _lcd(lcd),
+    _cells(0)
+#if MBED_CONF_RTOS_PRESENT
+    , _thread(osPriorityLow, 1024, nullptr, "lcd_output")
+#endif
+{
+    memset(_shadow, ' ', sizeof(_shadow));
+    memset(_shown, ' ', sizeof(_shown));
+}
+
+void LcdOutput::start(void)
+{
+#if MBED_CONF_RTOS_PRESENT
+    _thread.start(callback(this, &LcdOutput::run));
+#endif
+}
+
+void LcdOutput::begin(void)
+{
+    LCD_LOCK();
+}
+
+void LcdOutput::end(void)
+{
+    LCD_UNLOCK();
+#if MBED_CONF_RTOS_PRESENT
+    _flags.set(LCD_FLAG_UPDATE);
+#else
+    poll();
+#endif
+}
+
+void LcdOutput::clear(void)
+{
+    memset(_shadow, ' ', sizeof(_shadow));
+}
+
+int LcdOutput::printf(int x, int y, const char *format, ...)
+{
+    char buf[LCD_COLUMNS + 1];
+    va_list args;
+    int len;
+
+    if ((x < 0) || (x >= LCD_COLUMNS) || (y < 0) || (y >= LCD_ROWS)) {
+        return 0;
+    }
+    va_start(args, format);
+    len = vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    if (len < 0) {
+        return len;
+    }
+    // the rest of the line is cut, as the display does not wrap
+    if (len > LCD_COLUMNS - x) {
+        len = LCD_COLUMNS - x;
+    }
+    memcpy(&_shadow[y][x], buf, len);
+    return len;
+}
+
+void LcdOutput::poll(void)
+{
+    char frame[LCD_ROWS][LCD_COLUMNS];
+
+    // I2C is slow, so write from a copy and let the next update wait only for the copy
+    LCD_LOCK();
+    memcpy(frame, _shadow, sizeof(frame));
+    LCD_UNLOCK();
+
+    for (int y = 0; y < LCD_ROWS; y++) {
+        for (int x = 0; x < LCD_COLUMNS; x++) {
+            if (frame[y][x] != _shown[y][x]) {
+                _lcd.putcxy(frame[y][x], x, y);
+                _shown[y][x] = frame[y][x];
+                _cells++;
+            }
+        }
+    }
+}
+
+uint32_t LcdOutput::cells(void) const
+{
+    return _cells;
+}
+
+/* ------------------------
+ * local
+ * ------------------------ */
+
+#if MBED_CONF_RTOS_PRESENT
+void LcdOutput::run(void)
+{
+    while (true) {
+        _flags.wait_any(LCD_FLAG_UPDATE);
+        poll();
+    }
+}
+#endif
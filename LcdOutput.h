@@ -0,0 +1,65 @@
+/* Shadowed, differential character LCD output
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef LCD_OUTPUT_H_
+#define LCD_OUTPUT_H_
+
+#include <stdint.h>
+
+#include "mbed.h"
+#include "SB1602E.h"
+
+/* --------------------------------
+ * Constant
+ * -------------------------------- */
+
+#define LCD_COLUMNS                   8           // setCharsInLine()
+#define LCD_ROWS                      2
+
+/* --------------------------------
+ * Class Declaration
+ * -------------------------------- */
+
+/*
+ * Shadow framebuffer in front of the SB1602E. Writers only change the
+ * shadow in RAM, between begin() and end() so a half-drawn screen is
+ * never shown; a low priority thread (or poll() on bare-metal, called
+ * from end()) then writes just the cells that differ from the display.
+ * clear() blanks the shadow instead of sending the clear command, so a
+ * new screen replaces the old one without a blank frame in between.
+ *
+ * The display must be initialised and cleared before start().
+ */
+class LcdOutput
+{
+public:
+    LcdOutput(SB1602E &lcd);
+
+    void start(void);                           // starts the update thread
+
+    void begin(void);                           // start of a screen update
+    void end(void);                             // shows the update
+    void clear(void);
+    int printf(int x, int y, const char *format, ...);
+
+    void poll(void);                            // writes the changed cells now
+    uint32_t cells(void) const;                 // cells written to the display
+
+private:
+#if MBED_CONF_RTOS_PRESENT
+    void run(void);
+#endif
+
+    SB1602E &_lcd;
+    char _shadow[LCD_ROWS][LCD_COLUMNS];
+    char _shown[LCD_ROWS][LCD_COLUMNS];         // what the display holds, update thread only
+    uint32_t _cells;
+#if MBED_CONF_RTOS_PRESENT
+    Mutex _mutex;
+    EventFlags _flags;
+    Thread _thread;
+#endif
+};
+
+#endif /* !LCD_OUTPUT_H_ */
@@ -0,0 +1,240 @@
+/* Host-driven reader passthrough over USB serial
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+
+#include "Passthrough.h"
+
+#if PASSTHROUGH_QUEUE > 0
+
+/* --------------------------------
+ * Constant
+ * -------------------------------- */
+
+#define PT_FLAG_RX                    0x01        // USB data, or a slot became free
+#define PT_FLAG_REQUEST               0x02        // a request was queued
+#define PT_IDLE_INTERVAL              100ms       // checks the USB connection while idle
+
+#define CARD_COMMAND_MAX              254         // CommunicateThruEX, with the length byte
+
+#if MBED_CONF_RTOS_PRESENT
+#define PT_LOCK()                     _mutex.lock()
+#define PT_UNLOCK()                   _mutex.unlock()
+#else
+#define PT_LOCK()
+#define PT_UNLOCK()
+#endif
+
+/* --------------------------------
+ * Function
+ * -------------------------------- */
+
+static void put32(uint8_t *p, uint32_t v)
+{
+    for (int i = 0; i < 4; i++) {
+        p[i] = (uint8_t)(v >> (i * 8));
+    }
+}
+
+Passthrough::Passthrough(USBSerial &serial, RCS620S &reader, UsbOutput &out) :
+    _serial(serial),
+    _reader(reader),
+    _out(out),
+    _head(0),
+    _count(0),
+    _active(0)
+#if MBED_CONF_RTOS_PRESENT
+    , _thread(osPriorityAboveNormal, 1024, nullptr, "passthrough")
+#endif
+{
+}
+
+void Passthrough::start(void)
+{
+#if MBED_CONF_RTOS_PRESENT
+    _serial.attach(callback(this, &Passthrough::readable));
+    _thread.start(callback(this, &Passthrough::receiver));
+#endif
+}
+
+uint32_t Passthrough::run(void)
+{
+    uint32_t served = 0;
+
+    PT_LOCK();
+    for (int i = 0; i < PASSTHROUGH_QUEUE; i++) {
+        _slots[i].reset();
+    }
+    _head = 0;
+    _count = 0;
+    _active = 1;
+    PT_UNLOCK();
+#if MBED_CONF_RTOS_PRESENT
+    // the first requests may already be waiting behind the command that started the mode
+    _flags.set(PT_FLAG_RX);
+#endif
+
+    while (_serial.connected()) {
+#if MBED_CONF_RTOS_PRESENT
+        if (queued() == 0) {
+            _flags.wait_any_for(PT_FLAG_REQUEST, PT_IDLE_INTERVAL);
+            continue;
+        }
+#else
+        receive();
+        _out.poll();
+        if (queued() == 0) {
+            continue;
+        }
+#endif
+        // the slot stays taken until its response is out, so the receiver cannot overwrite the command
+        EventFrameParser *request = &_slots[_head];
+        int end = execute(request->payload(), request->length(), _received[_head]);
+        served++;
+
+        PT_LOCK();
+        _head = (_head + 1) % PASSTHROUGH_QUEUE;
+        _count--;
+        PT_UNLOCK();
+#if MBED_CONF_RTOS_PRESENT
+        _flags.set(PT_FLAG_RX);
+#endif
+        if (end) {
+            break;
+        }
+    }
+
+    // requests sent after the end are dropped
+    PT_LOCK();
+    _active = 0;
+    _count = 0;
+    PT_UNLOCK();
+    return served;
+}
+
+/* ------------------------
+ * local
+ * ------------------------ */
+
+/* moves bytes from USB into the free slots, returns 1 when a request was queued */
+int Passthrough::receive(void)
+{
+    int queued = 0;
+
+    PT_LOCK();
+    while (_active && (_count < PASSTHROUGH_QUEUE)) {
+        int tail = (_head + _count) % PASSTHROUGH_QUEUE;
+        EventFrameParser *slot = &_slots[tail];
+        // bytes that came behind the last request are parsed before any new ones
+        _slots[(tail + PASSTHROUGH_QUEUE - 1) % PASSTHROUGH_QUEUE].pass(slot);
+        int ready = slot->next();
+        if (!ready) {
+            if (!_serial.readable()) {
+                break;
+            }
+            ready = slot->put((uint8_t)_serial.getc());
+        }
+        if (ready && (slot->type() == EVENT_PASSTHROUGH)) {
+            // other frames are parsed over by the next one
+            _received[tail] = us_ticker_read();
+            _count++;
+            queued = 1;
+        }
+    }
+    PT_UNLOCK();
+    return queued;
+}
+
+/* runs one request and sends its response, returns 1 for PASSTHROUGH_END */
+int Passthrough::execute(const uint8_t *request, int len, uint32_t received)
+{
+    uint8_t *response = &_frame[EVENT_FRAME_HEADER];
+    uint8_t *data = &response[PASSTHROUGH_RESPONSE_SIZE];
+    uint8_t op = (len > 1) ? request[1] : 0;
+    int status = PASSTHROUGH_BAD_REQUEST;
+    int size = 0;
+    uint32_t start = us_ticker_read();
+
+    if (len >= PASSTHROUGH_REQUEST_SIZE) {
+        const uint8_t *command = &request[PASSTHROUGH_REQUEST_SIZE];
+        int command_len = len - PASSTHROUGH_REQUEST_SIZE;
+        uint16_t timeout = (uint16_t)(request[2] | (request[3] << 8));
+        unsigned long saved = _reader.timeout;
+
+        if (timeout != 0) {
+            _reader.timeout = timeout;
+        }
+        switch (op) {
+            case PASSTHROUGH_END:
+                status = PASSTHROUGH_OK;
+                break;
+            case PASSTHROUGH_RW:
+                if (command_len > 0) {
+                    uint16_t n;
+                    if (_reader.rwCommand(command, (uint16_t)command_len, data, &n)) {
+                        status = PASSTHROUGH_OK;
+                        size = n;
+                    }
+                    else {
+                        status = PASSTHROUGH_FAILED;
+                    }
+                }
+                break;
+            case PASSTHROUGH_CARD:
+                if ((command_len > 0) && (command_len < CARD_COMMAND_MAX)) {
+                    uint8_t n;
+                    if (_reader.cardCommand(command, (uint8_t)command_len, data, &n)) {
+                        status = PASSTHROUGH_OK;
+                        size = n;
+                    }
+                    else {
+                        status = PASSTHROUGH_FAILED;
+                    }
+                }
+                break;
+            default:
+                break;
+        }
+        _reader.timeout = saved;
+    }
+
+    uint32_t end = us_ticker_read();
+    response[0] = (len > 0) ? request[0] : 0;
+    response[1] = op;
+    response[2] = (uint8_t)status;
+    put32(&response[3], start - received);
+    put32(&response[7], end - start);
+    _out.write(_frame, event_frame_seal(EVENT_PASSTHROUGH, _frame, PASSTHROUGH_RESPONSE_SIZE + size));
+    _out.flush();       // the host waits for this response
+
+    return (op == PASSTHROUGH_END) && (status == PASSTHROUGH_OK);
+}
+
+int Passthrough::queued(void) const
+{
+    PT_LOCK();
+    int count = _count;
+    PT_UNLOCK();
+    return count;
+}
+
+#if MBED_CONF_RTOS_PRESENT
+/* called by USBSerial when data arrives (interrupt context) */
+void Passthrough::readable(void)
+{
+    _flags.set(PT_FLAG_RX);
+}
+
+void Passthrough::receiver(void)
+{
+    while (true) {
+        _flags.wait_any(PT_FLAG_RX);
+        if (receive()) {
+            _flags.set(PT_FLAG_REQUEST);
+        }
+    }
+}
+#endif
+
+#endif /* PASSTHROUGH_QUEUE > 0 */
@@ -0,0 +1,78 @@
+/* Host-driven reader passthrough over USB serial
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef PASSTHROUGH_H_
+#define PASSTHROUGH_H_
+
+#include <stdint.h>
+
+#include "mbed.h"
+#include "USBSerial.h"
+#include "RCS620S.h"
+#include "EventFrame.h"
+#include "UsbOutput.h"
+
+/* --------------------------------
+ * Constant
+ * -------------------------------- */
+
+/* requests the host may have in flight (passthrough-queue), 0 compiles the mode out */
+#ifndef PASSTHROUGH_QUEUE
+#define PASSTHROUGH_QUEUE             4
+#endif
+
+/* --------------------------------
+ * Class Declaration
+ * -------------------------------- */
+
+/*
+ * Lets the host drive the RC-S620/S with EVENT_PASSTHROUGH frames (see
+ * EventFrame.h). Each queue slot is a frame parser of its own: a request
+ * is parsed in place and its command goes from the slot straight to
+ * rwCommand() or cardCommand(), whose response is written where the
+ * response frame is sealed for UsbOutput.
+ *
+ * A receive thread keeps taking frames from USB into the free slots
+ * while the reader works on the oldest one, so the host can pipeline up
+ * to PASSTHROUGH_QUEUE requests and USB transfers overlap with RF time.
+ * When every slot is taken the thread stops reading and USB holds the
+ * host back. On bare-metal requests are received between commands.
+ *
+ * Requests run in order. A damaged frame is dropped without a response,
+ * so the host should time out a sequence number it never sees.
+ */
+class Passthrough
+{
+public:
+    Passthrough(USBSerial &serial, RCS620S &reader, UsbOutput &out);
+
+    void start(void);                           // starts the receive thread
+    uint32_t run(void);                         // serves requests until PASSTHROUGH_END, returns their count
+
+private:
+    int receive(void);
+    int execute(const uint8_t *request, int len, uint32_t received);
+    int queued(void) const;
+#if MBED_CONF_RTOS_PRESENT
+    void readable(void);
+    void receiver(void);
+#endif
+
+    USBSerial &_serial;
+    RCS620S &_reader;
+    UsbOutput &_out;
+    EventFrameParser _slots[PASSTHROUGH_QUEUE];
+    uint32_t _received[PASSTHROUGH_QUEUE];      // when each request was complete, us_ticker_read()
+    int _head;                                  // oldest request
+    int _count;
+    int _active;
+    uint8_t _frame[EVENT_FRAME_LENGTH_MAX + EVENT_FRAME_OVERHEAD];     // response
+#if MBED_CONF_RTOS_PRESENT
+    mutable Mutex _mutex;
+    EventFlags _flags;
+    Thread _thread;
+#endif
+};
+
+#endif /* !PASSTHROUGH_H_ */
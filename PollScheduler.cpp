@@ -0,0 +1,74 @@
+/* Adaptive card polling interval
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "PollScheduler.h"
+
+/* --------------------------------
+ * Constant
+ * -------------------------------- */
+
+static const poll_profile profiles[POLL_PROFILE_COUNT] = {
+    // fast, hold, idle, deep after, deep
+    {  30, 10000, 150, 600000, 300 },       // POLL_PROFILE_NORMAL
+    {  20, 60000,  50,      0,  50 },       // POLL_PROFILE_RUSH
+};
+
+/* --------------------------------
+ * Function
+ * -------------------------------- */
+
+PollScheduler::PollScheduler(int profile) :
+    _profile(&profiles[POLL_PROFILE_NORMAL]),
+    _index(POLL_PROFILE_NORMAL),
+    _last_activity(0),
+    _interval(0)
+{
+    setProfile(profile);
+    _interval = _profile->fast_interval;
+}
+
+void PollScheduler::setProfile(int profile)
+{
+    if ((profile < 0) || (profile >= POLL_PROFILE_COUNT)) {
+        return;
+    }
+    _index = profile;
+    _profile = &profiles[profile];
+}
+
+int PollScheduler::profile(void) const
+{
+    return _index;
+}
+
+void PollScheduler::activity(uint32_t now)
+{
+    _last_activity = now;
+    _interval = _profile->fast_interval;
+}
+
+uint32_t PollScheduler::next(uint32_t now)
+{
+    uint32_t idle = now - _last_activity;
+
+    if (idle < _profile->fast_hold) {
+        _interval = _profile->fast_interval;
+    }
+    else if ((_profile->deep_after != 0) && (idle >= _profile->deep_after)) {
+        _interval = _profile->deep_interval;
+    }
+    else {
+        // back off gradually towards the idle interval
+        _interval += _interval / 2 + 1;
+        if (_interval > _profile->idle_interval) {
+            _interval = _profile->idle_interval;
+        }
+    }
+    return _interval;
+}
+
+uint32_t PollScheduler::interval(void) const
+{
+    return _interval;
+}
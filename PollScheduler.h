@@ -0,0 +1,66 @@
+/* Adaptive card polling interval
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef POLL_SCHEDULER_H_
+#define POLL_SCHEDULER_H_
+
+#include <stdint.h>
+
+/* --------------------------------
+ * Constant
+ * -------------------------------- */
+
+/* poll-profile (POLL_PROFILE) */
+#define POLL_PROFILE_NORMAL           0
+#define POLL_PROFILE_RUSH             1           // stay fast longer, never sleep deeply
+#define POLL_PROFILE_COUNT            2
+
+#ifndef POLL_PROFILE
+#define POLL_PROFILE                  POLL_PROFILE_NORMAL
+#endif
+
+/* --------------------------------
+ * Structure
+ * -------------------------------- */
+
+/* all times in milliseconds */
+struct poll_profile {
+    uint16_t fast_interval;     // right after a card
+    uint32_t fast_hold;         // how long the fast interval is kept after the last card
+    uint16_t idle_interval;     // longest interval while idle, reached by backing off
+    uint32_t deep_after;        // idle time before deep idle, 0 for never
+    uint16_t deep_interval;
+};
+
+/* --------------------------------
+ * Class Declaration
+ * -------------------------------- */
+
+/*
+ * Decides how long the main loop sleeps between polling cycles. The RF
+ * field is only on during a cycle, so a short interval right after a
+ * card (the next person in line is likely close) costs little, and the
+ * interval grows by half each cycle once nobody has come for a while.
+ * Times are the caller's millisecond clock; wrap-around is harmless.
+ */
+class PollScheduler
+{
+public:
+    PollScheduler(int profile = POLL_PROFILE);
+
+    void setProfile(int profile);
+    int profile(void) const;
+
+    void activity(uint32_t now);                // a new card was read
+    uint32_t next(uint32_t now);                // sleep before the next cycle
+    uint32_t interval(void) const;              // last value of next()
+
+private:
+    const poll_profile *_profile;
+    int _index;
+    uint32_t _last_activity;
+    uint32_t _interval;
+};
+
+#endif /* !POLL_SCHEDULER_H_ */
@@ -0,0 +1,374 @@
+/* Background print spooler
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "PrintSpooler.h"
+
+/* --------------------------------
+ * Constant
+ * -------------------------------- */
+
+/* records: op(1) length(2, LE) data */
+#define SPOOL_JOB_START               0x01        // job id(4, LE)
+#define SPOOL_TEXT                    0x02
+#define SPOOL_FEED                    0x03        // lines(1)
+#define SPOOL_WIDTH                   0x04        // double width(1)
+#define SPOOL_JOB_END                 0x05        // job size(2, LE)
+
+#define SPOOL_HEADER                  3
+#define SPOOL_END_SIZE                (SPOOL_HEADER + 2)
+
+#define PRINT_PRINTF_SIZE             128
+#define PRINT_FLAG_JOB                0x01
+#define PRINT_BUSY_INTERVAL           10ms
+
+#if MBED_CONF_RTOS_PRESENT
+#define PRINT_LOCK()                  _mutex.lock()
+#define PRINT_UNLOCK()                _mutex.unlock()
+#else
+#define PRINT_LOCK()
+#define PRINT_UNLOCK()
+#endif
+
+/* --------------------------------
+ * Function
+ * -------------------------------- */
+
+PrintSpooler::PrintSpooler(PrintDevice &device) :
+    _device(device),
+    _head(0),
+    _count(0),
+    _open(0),
+    _last(-1),
+    _overflow(0),
+    _double(0),
+    _job_double(0),
+    _next_id(1),
+    _job(0),
+    _job_size(0),
+    _text_left(0),
+    _status_head(0),
+    _status_count(0)
+#if MBED_CONF_RTOS_PRESENT
+    , _thread(osPriorityBelowNormal, 1024, nullptr, "print_spooler")
+#endif
+{
+}
+
+void PrintSpooler::start(void)
+{
+#if MBED_CONF_RTOS_PRESENT
+    _thread.start(callback(this, &PrintSpooler::run));
+#endif
+}
+
+ssize_t PrintSpooler::write(const void *data, size_t len)
+{
+    if (len > 0) {
+        append(SPOOL_TEXT, (const uint8_t *)data, len);
+    }
+    return len;
+}
+
+int PrintSpooler::printf(const char *format, ...)
+{
+    char buf[PRINT_PRINTF_SIZE];
+    va_list args;
+    int len;
+
+    va_start(args, format);
+    len = vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    if (len < 0) {
+        return len;
+    }
+    if (len >= (int)sizeof(buf)) {
+        len = sizeof(buf) - 1;
+    }
+    write(buf, len);
+    return len;
+}
+
+void PrintSpooler::putLineFeed(uint32_t lines)
+{
+    while (lines > 0) {
+        uint8_t n = (lines > 0xFF) ? 0xFF : (uint8_t)lines;
+        append(SPOOL_FEED, &n, 1);
+        lines -= n;
+    }
+}
+
+void PrintSpooler::setDoubleSizeWidth(void)
+{
+    uint8_t on = 1;
+    append(SPOOL_WIDTH, &on, 1);
+}
+
+void PrintSpooler::clearDoubleSizeWidth(void)
+{
+    uint8_t on = 0;
+    append(SPOOL_WIDTH, &on, 1);
+}
+
+uint32_t PrintSpooler::submit(void)
+{
+    uint32_t id = _next_id;
+    uint16_t size;
+
+    if (_open == 0) {
+        return 0;
+    }
+    _next_id++;
+    if (_overflow) {
+        // the printer never sees this job, so neither its width changes
+        size = (uint16_t)_open;
+        _open = 0;
+        _last = -1;
+        _overflow = 0;
+        _double = _job_double;
+        report(id, PRINT_JOB_DROPPED, size);
+        return id;
+    }
+
+    PRINT_LOCK();
+    size = (uint16_t)(_open + SPOOL_END_SIZE);
+    size_t base = _head + _count + _open;
+    put(base, SPOOL_JOB_END);
+    put(base + 1, 2);
+    put(base + 2, 0);
+    put(base + 3, (uint8_t)size);
+    put(base + 4, (uint8_t)(size >> 8));
+    _count += _open + SPOOL_END_SIZE;
+    _open = 0;
+    _last = -1;
+    _job_double = _double;
+    PRINT_UNLOCK();
+
+    report(id, PRINT_JOB_QUEUED, size);
+#if MBED_CONF_RTOS_PRESENT
+    _flags.set(PRINT_FLAG_JOB);
+#else
+    poll();
+#endif
+    return id;
+}
+
+void PrintSpooler::poll(void)
+{
+    uint8_t chunk[PRINT_CHUNK_SIZE];
+
+    while (true) {
+        PRINT_LOCK();
+        if ((_count == 0) && (_text_left == 0)) {
+            PRINT_UNLOCK();
+            return;
+        }
+        if (_device.busy()) {
+            PRINT_UNLOCK();
+            return;
+        }
+
+        if (_text_left > 0) {
+            size_t n = (_text_left < sizeof(chunk)) ? _text_left : sizeof(chunk);
+            for (size_t i = 0; i < n; i++) {
+                chunk[i] = get(_head + i);
+            }
+            PRINT_UNLOCK();
+
+            _device.write(chunk, n);
+
+            PRINT_LOCK();
+            _head = (_head + n) % PRINTER_SPOOL_SIZE;
+            _count -= n;
+            _text_left -= n;
+            PRINT_UNLOCK();
+            continue;
+        }
+
+        uint8_t op = get(_head);
+        size_t len = get(_head + 1) | (get(_head + 2) << 8);
+        uint8_t data[4] = { 0, 0, 0, 0 };
+        if (op != SPOOL_TEXT) {
+            for (size_t i = 0; (i < len) && (i < sizeof(data)); i++) {
+                data[i] = get(_head + SPOOL_HEADER + i);
+            }
+            len += SPOOL_HEADER;
+        }
+        else {
+            _text_left = len;
+            len = SPOOL_HEADER;
+        }
+        _head = (_head + len) % PRINTER_SPOOL_SIZE;
+        _count -= len;
+        PRINT_UNLOCK();
+
+        // the record is consumed before the printer is driven, so a slow
+        // command does not hold the lock; a record is never split
+        switch (op) {
+            case SPOOL_JOB_START:
+                _job = data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+                report(_job, PRINT_JOB_PRINTING, 0);
+                break;
+            case SPOOL_FEED:
+                _device.lineFeed(data[0]);
+                break;
+            case SPOOL_WIDTH:
+                _device.doubleWidth(data[0]);
+                break;
+            case SPOOL_JOB_END:
+                _job_size = (uint16_t)(data[0] | (data[1] << 8));
+                report(_job, PRINT_JOB_DONE, _job_size);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+int PrintSpooler::status(print_job_status *status)
+{
+    PRINT_LOCK();
+    if (_status_count == 0) {
+        PRINT_UNLOCK();
+        return 0;
+    }
+    *status = _status[_status_head];
+    _status_head = (_status_head + 1) % PRINT_STATUS_QUEUE;
+    _status_count--;
+    PRINT_UNLOCK();
+    return 1;
+}
+
+size_t PrintSpooler::pending(void) const
+{
+    PRINT_LOCK();
+    size_t count = _count;
+    PRINT_UNLOCK();
+    return count;
+}
+
+/* ------------------------
+ * local
+ * ------------------------ */
+
+void PrintSpooler::put(size_t offset, uint8_t c)
+{
+    _buffer[offset % PRINTER_SPOOL_SIZE] = c;
+}
+
+uint8_t PrintSpooler::get(size_t offset) const
+{
+    return _buffer[offset % PRINTER_SPOOL_SIZE];
+}
+
+/* adds a record to the open job, merged with the last one where possible */
+void PrintSpooler::append(uint8_t op, const uint8_t *data, size_t len)
+{
+    if (_overflow) {
+        return;
+    }
+
+    PRINT_LOCK();
+    size_t job = _head + _count;                // start of the open job in the ring
+    size_t space = PRINTER_SPOOL_SIZE - _count - _open;
+    uint8_t last = (_last >= 0) ? get(job + _last) : 0;
+    size_t last_len = (_last >= 0) ? (get(job + _last + 1) | (get(job + _last + 2) << 8)) : 0;
+
+    if (op == SPOOL_WIDTH) {
+        if (data[0] == _double) {
+            PRINT_UNLOCK();
+            return;
+        }
+        _double = data[0];
+        if (last == SPOOL_WIDTH) {
+            // set and cleared again with nothing in between
+            _open = _last;
+            _last = -1;
+            PRINT_UNLOCK();
+            return;
+        }
+    }
+
+    if ((op == SPOOL_TEXT) && (last == SPOOL_TEXT) && (last_len + len <= 0xFFFF)) {
+        if (len + SPOOL_END_SIZE > space) {
+            _overflow = 1;
+        }
+        else {
+            for (size_t i = 0; i < len; i++) {
+                put(job + _open + i, data[i]);
+            }
+            _open += len;
+            last_len += len;
+            put(job + _last + 1, (uint8_t)last_len);
+            put(job + _last + 2, (uint8_t)(last_len >> 8));
+        }
+        PRINT_UNLOCK();
+        return;
+    }
+    if ((op == SPOOL_FEED) && (last == SPOOL_FEED) && (get(job + _last + SPOOL_HEADER) + data[0] <= 0xFF)) {
+        put(job + _last + SPOOL_HEADER, get(job + _last + SPOOL_HEADER) + data[0]);
+        PRINT_UNLOCK();
+        return;
+    }
+
+    size_t start = (_open == 0) ? SPOOL_HEADER + 4 : 0;
+    if (start + SPOOL_HEADER + len + SPOOL_END_SIZE > space) {
+        _overflow = 1;
+        PRINT_UNLOCK();
+        return;
+    }
+    if (_open == 0) {
+        put(job, SPOOL_JOB_START);
+        put(job + 1, 4);
+        put(job + 2, 0);
+        for (int i = 0; i < 4; i++) {
+            put(job + SPOOL_HEADER + i, (uint8_t)(_next_id >> (i * 8)));
+        }
+        _open = start;
+    }
+    _last = (int)_open;
+    put(job + _open, op);
+    put(job + _open + 1, (uint8_t)len);
+    put(job + _open + 2, (uint8_t)(len >> 8));
+    for (size_t i = 0; i < len; i++) {
+        put(job + _open + SPOOL_HEADER + i, data[i]);
+    }
+    _open += SPOOL_HEADER + len;
+    PRINT_UNLOCK();
+}
+
+void PrintSpooler::report(uint32_t id, uint8_t state, uint16_t size)
+{
+    PRINT_LOCK();
+    if (_status_count == PRINT_STATUS_QUEUE) {
+        // the oldest change is lost
+        _status_head = (_status_head + 1) % PRINT_STATUS_QUEUE;
+        _status_count--;
+    }
+    print_job_status *s = &_status[(_status_head + _status_count) % PRINT_STATUS_QUEUE];
+    s->id = id;
+    s->state = state;
+    s->size = size;
+    _status_count++;
+    PRINT_UNLOCK();
+}
+
+#if MBED_CONF_RTOS_PRESENT
+void PrintSpooler::run(void)
+{
+    while (true) {
+        if (pending() == 0) {
+            _flags.wait_any(PRINT_FLAG_JOB);
+        }
+        else {
+            // the device was busy
+            _flags.wait_any_for(PRINT_FLAG_JOB, PRINT_BUSY_INTERVAL);
+        }
+        poll();
+    }
+}
+#endif
@@ -0,0 +1,122 @@
+/* Background print spooler
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef PRINT_SPOOLER_H_
+#define PRINT_SPOOLER_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "mbed.h"
+
+/* --------------------------------
+ * Constant
+ * -------------------------------- */
+
+#ifndef PRINTER_SPOOL_SIZE
+#define PRINTER_SPOOL_SIZE            4096
+#endif
+
+#define PRINT_CHUNK_SIZE              64          // text bytes per write to the printer
+#define PRINT_STATUS_QUEUE            8
+
+/* job states */
+#define PRINT_JOB_QUEUED              0
+#define PRINT_JOB_PRINTING            1
+#define PRINT_JOB_DONE                2
+#define PRINT_JOB_DROPPED             3           // did not fit in the spool
+
+/* --------------------------------
+ * Structure
+ * -------------------------------- */
+
+struct print_job_status {
+    uint32_t id;
+    uint8_t state;              // PRINT_JOB_*
+    uint16_t size;              // spooled bytes
+};
+
+/* --------------------------------
+ * Class Declaration
+ * -------------------------------- */
+
+/* the printer as the spooler drives it */
+class PrintDevice
+{
+public:
+    virtual ~PrintDevice() {}
+    virtual void write(const uint8_t *data, size_t len) = 0;
+    virtual void lineFeed(int lines) = 0;
+    virtual void doubleWidth(int on) = 0;
+    virtual int busy(void)                      // the printer cannot take data now
+    {
+        return 0;
+    }
+};
+
+/*
+ * Collects the output of one receipt as a job and prints it in the
+ * background. The calls mirror AS289R2; they append records to the job
+ * in RAM, merging adjacent text into one write, adding up line feeds and
+ * dropping width changes that cancel out. submit() queues the job, and a
+ * low priority thread (or poll() on bare-metal) replays it on the
+ * PrintDevice a chunk at a time, waiting while the device is busy.
+ *
+ * A job that does not fit in the free part of the spool is dropped as a
+ * whole. Job state changes are queued for status().
+ */
+class PrintSpooler
+{
+public:
+    PrintSpooler(PrintDevice &device);
+
+    void start(void);                           // starts the print thread
+
+    ssize_t write(const void *data, size_t len);
+    int printf(const char *format, ...);
+    void putLineFeed(uint32_t lines);
+    void setDoubleSizeWidth(void);
+    void clearDoubleSizeWidth(void);
+    uint32_t submit(void);                      // queues the job, returns its id (0 if empty)
+
+    void poll(void);                            // prints until done or the device is busy
+    int status(print_job_status *status);       // 1 when a state change was taken
+    size_t pending(void) const;                 // queued bytes
+
+private:
+    void append(uint8_t op, const uint8_t *data, size_t len);
+    void put(size_t offset, uint8_t c);
+    uint8_t get(size_t offset) const;
+    void report(uint32_t id, uint8_t state, uint16_t size);
+#if MBED_CONF_RTOS_PRESENT
+    void run(void);
+#endif
+
+    PrintDevice &_device;
+    uint8_t _buffer[PRINTER_SPOOL_SIZE];
+    size_t _head;                               // next byte to print
+    size_t _count;                              // queued bytes
+    size_t _open;                               // bytes of the job being built
+    int _last;                                  // offset of its last record, -1 for none
+    int _overflow;
+    int _double;                                // width once every queued job has printed
+    int _job_double;                            // the same at the start of the open job
+    uint32_t _next_id;
+
+    // print side
+    uint32_t _job;
+    uint16_t _job_size;
+    size_t _text_left;
+
+    print_job_status _status[PRINT_STATUS_QUEUE];
+    int _status_head;
+    int _status_count;
+#if MBED_CONF_RTOS_PRESENT
+    mutable Mutex _mutex;
+    EventFlags _flags;
+    Thread _thread;
+#endif
+};
+
+#endif /* !PRINT_SPOOLER_H_ */
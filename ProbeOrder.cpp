@@ -0,0 +1,131 @@
+/* Probe order learned from the cards seen
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "ProbeOrder.h"
+
+/* --------------------------------
+ * Function
+ * -------------------------------- */
+
+ProbeOrder::ProbeOrder(int count) :
+    _count((count < PROBE_ORDER_MAX) ? count : PROBE_ORDER_MAX),
+    _changed(0),
+    _unsaved(0)
+{
+    memset(_hits, 0, sizeof(_hits));
+    for (int i = 0; i < PROBE_ORDER_MAX; i++) {
+        _order[i] = (uint8_t)i;
+    }
+}
+
+int ProbeOrder::at(int rank) const
+{
+    return _order[rank];
+}
+
+uint16_t ProbeOrder::hits(int family) const
+{
+    return _hits[family];
+}
+
+/* insertion sort by hits, descending; ties by family index */
+void ProbeOrder::sort(void)
+{
+    for (int i = 1; i < _count; i++) {
+        uint8_t f = _order[i];
+        int j = i;
+        while ((j > 0) && ((_hits[_order[j - 1]] < _hits[f]) ||
+                           ((_hits[_order[j - 1]] == _hits[f]) && (_order[j - 1] > f)))) {
+            _order[j] = _order[j - 1];
+            j--;
+        }
+        _order[j] = f;
+    }
+}
+
+void ProbeOrder::record(int family)
+{
+    if ((family < 0) || (family >= _count)) {
+        return;
+    }
+    if (++_hits[family] >= PROBE_ORDER_LIMIT) {
+        for (int i = 0; i < _count; i++) {
+            _hits[i] /= 2;
+        }
+    }
+
+    // only the recorded family can move, and only forward
+    int rank = 0;
+    while (_order[rank] != family) {
+        rank++;
+    }
+    if ((rank > 0) && (_hits[_order[rank - 1]] < _hits[family])) {
+        _changed = 1;
+    }
+    sort();
+    _unsaved++;
+}
+
+int ProbeOrder::dirty(void) const
+{
+    return _changed || (_unsaved >= PROBE_ORDER_SAVE_INTERVAL);
+}
+
+int ProbeOrder::load(const char *path)
+{
+    FILE *fp = fopen(path, "rb");
+    probe_stats_header header;
+    uint16_t hits[PROBE_ORDER_MAX];
+
+    if (fp == NULL) {
+        return 0;
+    }
+    int ok = (fread(&header, sizeof(header), 1, fp) == 1) &&
+             (header.magic == PROBE_STATS_MAGIC) && (header.version == PROBE_STATS_VERSION) &&
+             (header.count == _count) &&
+             (fread(hits, sizeof(hits[0]), _count, fp) == (size_t)_count) &&
+             (fgetc(fp) == EOF);
+    fclose(fp);
+    if (!ok) {
+        return 0;
+    }
+    for (int i = 0; i < _count; i++) {
+        _hits[i] = (hits[i] < PROBE_ORDER_LIMIT) ? hits[i] : PROBE_ORDER_LIMIT - 1;
+    }
+    sort();
+    _changed = 0;
+    _unsaved = 0;
+    return 1;
+}
+
+int ProbeOrder::save(const char *path)
+{
+    char temp[64];
+    probe_stats_header header;
+
+    if (snprintf(temp, sizeof(temp), "%s.tmp", path) >= (int)sizeof(temp)) {
+        return 0;
+    }
+    FILE *fp = fopen(temp, "wb");
+    if (fp == NULL) {
+        return 0;
+    }
+    header.magic = PROBE_STATS_MAGIC;
+    header.version = PROBE_STATS_VERSION;
+    header.count = (uint16_t)_count;
+    int ok = (fwrite(&header, sizeof(header), 1, fp) == 1) &&
+             (fwrite(_hits, sizeof(_hits[0]), _count, fp) == (size_t)_count);
+    if ((fclose(fp) != 0) || !ok) {
+        remove(temp);
+        return 0;
+    }
+    if (rename(temp, path) != 0) {
+        return 0;
+    }
+    _changed = 0;
+    _unsaved = 0;
+    return 1;
+}
@@ -0,0 +1,67 @@
+/* Probe order learned from the cards seen
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef PROBE_ORDER_H_
+#define PROBE_ORDER_H_
+
+#include <stdint.h>
+
+/* --------------------------------
+ * Constant
+ * -------------------------------- */
+
+#define PROBE_ORDER_MAX               16          // families
+#define PROBE_ORDER_LIMIT             1024        // counts are halved when one reaches this
+#define PROBE_ORDER_SAVE_INTERVAL     32          // taps between saves while the order holds
+
+#define PROBE_STATS_MAGIC             0x42505253  // "SRPB"
+#define PROBE_STATS_VERSION           1
+
+/* --------------------------------
+ * Structure
+ * -------------------------------- */
+
+/* file layout, followed by count x uint16_t counts */
+struct probe_stats_header {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t count;
+};
+
+/* --------------------------------
+ * Class Declaration
+ * -------------------------------- */
+
+/*
+ * Keeps the caller's probes (family indices 0..count-1) sorted by how
+ * often each one identified a card, so the common families at this
+ * reader are tried first. Ties keep the original order. Counts are halved
+ * at PROBE_ORDER_LIMIT, so the order follows a change of customers
+ * within a few hundred taps. save() writes a temporary file and renames
+ * it over path.
+ */
+class ProbeOrder
+{
+public:
+    ProbeOrder(int count);
+
+    int at(int rank) const;                     // family probed at rank
+    uint16_t hits(int family) const;
+    void record(int family);                    // family identified a card
+
+    int dirty(void) const;                      // worth saving
+    int load(const char *path);
+    int save(const char *path);
+
+private:
+    void sort(void);
+
+    int _count;
+    uint16_t _hits[PROBE_ORDER_MAX];
+    uint8_t _order[PROBE_ORDER_MAX];
+    int _changed;
+    int _unsaved;
+};
+
+#endif /* !PROBE_ORDER_H_ */
@@ -202,10 +202,6 @@ int RCS620S::push(
     return 1;
 }
 
-/* ------------------------
- * private
- * ------------------------ */
-
 int RCS620S::rwCommand(
     const uint8_t* command,
     uint16_t commandLen,
@@ -290,6 +286,10 @@ int RCS620S::rwCommand(
     return 1;
 }
 
+/* ------------------------
+ * private
+ * ------------------------ */
+
 void RCS620S::cancel(void)
 {
     /* transmit an ACK */
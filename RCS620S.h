@@ -40,12 +40,13 @@ public:
         const uint8_t* data,
         uint8_t dataLen);
 
-private:
     int rwCommand(
         const uint8_t* command,
         uint16_t commandLen,
         uint8_t response[RCS620S_MAX_RW_RESPONSE_LEN],
         uint16_t* responseLen);
+
+private:
     void cancel(void);
     uint8_t calcDCS(
         const uint8_t* data,
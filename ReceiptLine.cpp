@@ -0,0 +1,250 @@
+/* History output line in the serial and printer encodings
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+
+#include "ReceiptLine.h"
+
+/* --------------------------------
+ * Function
+ * -------------------------------- */
+
+/* ------------------------
+ * ReceiptLine
+ * ------------------------ */
+
+ReceiptLine::ReceiptLine()
+{
+    clear();
+}
+
+void ReceiptLine::clear(void)
+{
+    _text[0] = '\0';
+    _text_len = 0;
+#if PRINTER_SJIS
+    _print[0] = '\0';
+    _print_len = 0;
+#endif
+    _newlines = 0;
+}
+
+void ReceiptLine::format(label_id id)
+{
+    append(label_text(id), label_print(id));
+}
+
+void ReceiptLine::append(const char *text, const char *print)
+{
+    copy(_text, &_text_len, text, false);
+#if PRINTER_SJIS
+    copy(_print, &_print_len, print, true);
+#else
+    (void)print;
+#endif
+}
+
+void ReceiptLine::add(const char *s)
+{
+    append(s, s);
+}
+
+void ReceiptLine::add(char c)
+{
+    char s[2] = { c, '\0' };
+
+    append(s, s);
+}
+
+void ReceiptLine::dec(long value, int width, char fill)
+{
+    char digits[24];
+    char s[RECEIPT_LINE_SIZE];
+    unsigned long u = (value < 0) ? 0UL - (unsigned long)value : (unsigned long)value;
+    int n = 0;
+    int i = 0;
+
+    do {
+        digits[n++] = (char)('0' + (u % 10));
+        u /= 10;
+    } while (u != 0);
+
+    if (value < 0) {
+        if (fill == '0') {
+            s[i++] = '-';
+        } else {
+            digits[n++] = '-';
+        }
+    }
+    while ((i + n < width) && (i + n < RECEIPT_LINE_SIZE - 1)) {
+        s[i++] = fill;
+    }
+    while (n > 0) {
+        s[i++] = digits[--n];
+    }
+    s[i] = '\0';
+
+    add(s);
+}
+
+void ReceiptLine::hex(uint32_t value, int digits, bool upper)
+{
+    const char *table = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+    char s[9];
+    int n = 0;
+
+    /* at least 'digits' digits, more if the value needs them */
+    while ((n < 8) && ((n < digits) || ((value >> (n * 4)) != 0))) {
+        n++;
+    }
+    if (n == 0) {
+        n = 1;
+    }
+    s[n] = '\0';
+    for (int i = n - 1; i >= 0; i--) {
+        s[i] = table[value & 0xF];
+        value >>= 4;
+    }
+
+    add(s);
+}
+
+void ReceiptLine::date(int year, int month, int day, int width, char fill)
+{
+    dec(year);
+    format(LABEL_YEAR);
+    dec(month, width, fill);
+    format(LABEL_MONTH);
+    dec(day, width, fill);
+    format(LABEL_DAY);
+}
+
+void ReceiptLine::time(int hour, int minute)
+{
+    dec(hour, 2, '0');
+    add(':');
+    dec(minute, 2, '0');
+}
+
+void ReceiptLine::yen(long value)
+{
+    dec(value);
+    format(LABEL_YEN);
+}
+
+void ReceiptLine::newline(void)
+{
+    _newlines++;
+}
+
+const char *ReceiptLine::text(void) const
+{
+    return _text;
+}
+
+const char *ReceiptLine::print(void) const
+{
+#if PRINTER_SJIS
+    return _print;
+#else
+    return _text;
+#endif
+}
+
+size_t ReceiptLine::textLength(void) const
+{
+    return _text_len;
+}
+
+size_t ReceiptLine::printLength(void) const
+{
+#if PRINTER_SJIS
+    return _print_len;
+#else
+    return _text_len;
+#endif
+}
+
+int ReceiptLine::newlines(void) const
+{
+    return _newlines;
+}
+
+/* ------------------------
+ * ReceiptLine private
+ * ------------------------ */
+
+/* whole characters only, UTF-8 or Shift_JIS, so a full line never ends in half of one */
+void ReceiptLine::copy(char *buf, size_t *len, const char *s, bool sjis)
+{
+    while (*s != '\0') {
+        uint8_t c = (uint8_t)*s;
+        size_t n = 1;
+        if (sjis) {
+            n = (((c >= 0x81) && (c <= 0x9F)) || ((c >= 0xE0) && (c <= 0xFC))) ? 2 : 1;
+        } else if (c >= 0xF0) {
+            n = 4;
+        } else if (c >= 0xE0) {
+            n = 3;
+        } else if (c >= 0xC0) {
+            n = 2;
+        }
+        if (*len + n > RECEIPT_LINE_SIZE - 1) {
+            break;
+        }
+        for (size_t i = 0; (i < n) && (*s != '\0'); i++) {
+            buf[(*len)++] = *s++;
+        }
+    }
+    buf[*len] = '\0';
+}
+
+/* ------------------------
+ * ReceiptSink
+ * ------------------------ */
+
+ReceiptSink::ReceiptSink(int copy, const char *newline) :
+    _copy(copy),
+    _newline(newline),
+    _newline_len(strlen(newline))
+{
+}
+
+void ReceiptSink::write(const ReceiptLine &line)
+{
+    if (_copy == RECEIPT_PRINT) {
+        output(line.print(), line.printLength());
+    } else {
+        output(line.text(), line.textLength());
+    }
+    for (int i = 0; i < line.newlines(); i++) {
+        output(_newline, _newline_len);
+    }
+}
+
+/* ------------------------
+ * ReceiptOutput
+ * ------------------------ */
+
+ReceiptOutput::ReceiptOutput() :
+    _count(0)
+{
+}
+
+int ReceiptOutput::attach(ReceiptSink *sink)
+{
+    if (_count >= RECEIPT_OUTPUT_SINKS) {
+        return 0;
+    }
+    _sinks[_count++] = sink;
+
+    return 1;
+}
+
+void ReceiptOutput::write(const ReceiptLine &line)
+{
+    for (int i = 0; i < _count; i++) {
+        _sinks[i]->write(line);
+    }
+}
@@ -0,0 +1,110 @@
+/* History output line in the serial and printer encodings
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef RECEIPT_LINE_H_
+#define RECEIPT_LINE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "Labels.h"
+
+/* --------------------------------
+ * Constant
+ * -------------------------------- */
+
+#define RECEIPT_LINE_SIZE             164
+#define RECEIPT_OUTPUT_SINKS          4
+
+/* ReceiptSink copy */
+#define RECEIPT_TEXT                  0           // text(), UTF-8
+#define RECEIPT_PRINT                 1           // print(), printer encoding
+
+/* --------------------------------
+ * Class Declaration
+ * -------------------------------- */
+
+/*
+ * One line of output built from labels. text() is UTF-8 for USB serial.
+ * With PRINTER_SJIS the printer copy is built alongside from the Shift_JIS
+ * labels and station names, so print() needs no conversion; otherwise
+ * print() is the same buffer as text(). Output is truncated, not overrun,
+ * at RECEIPT_LINE_SIZE, and never in the middle of a character.
+ *
+ * Both lengths are tracked, so appending never rescans the line. Nothing
+ * goes through vsnprintf: labels are fixed text, numbers are formatted by
+ * dec() and hex().
+ */
+class ReceiptLine
+{
+public:
+    ReceiptLine();
+
+    void clear(void);
+    void format(label_id id);                           // label in the encoding of each copy
+    void append(const char *text, const char *print);   // e.g. station names from both images
+    void add(const char *s);                            // same bytes in both copies
+    void add(char c);
+    void dec(long value, int width = 0, char fill = ' ');
+    void hex(uint32_t value, int digits = 2, bool upper = false);
+    void date(int year, int month, int day, int width = 0, char fill = ' ');   // 2024年2月29日
+    void time(int hour, int minute);                    // 09:05
+    void yen(long value);                               // 1520円
+    void newline(void);                                 // ends the line, see ReceiptSink
+
+    const char *text(void) const;
+    const char *print(void) const;
+    size_t textLength(void) const;
+    size_t printLength(void) const;
+    int newlines(void) const;
+
+private:
+    static void copy(char *buf, size_t *len, const char *s, bool sjis);
+
+    char _text[RECEIPT_LINE_SIZE];
+    size_t _text_len;
+#if PRINTER_SJIS
+    char _print[RECEIPT_LINE_SIZE];
+    size_t _print_len;
+#endif
+    int _newlines;
+};
+
+/*
+ * Destination of finished lines, e.g. USB serial or the printer. A sink
+ * takes one copy of the line and ends it with its own newline sequence,
+ * once per newline() ("\n" for a terminal, "\r" for the printer).
+ */
+class ReceiptSink
+{
+public:
+    ReceiptSink(int copy, const char *newline);
+    virtual ~ReceiptSink() {}
+
+    void write(const ReceiptLine &line);
+    virtual void output(const char *data, size_t len) = 0;
+    virtual void doubleWidth(bool /*on*/) {}            // printer sinks widen the following lines
+    virtual void lineFeed(int /*lines*/) {}             // printer sinks feed the paper
+
+private:
+    int _copy;
+    const char *_newline;
+    size_t _newline_len;
+};
+
+/* writes one formatted line to every attached sink */
+class ReceiptOutput
+{
+public:
+    ReceiptOutput();
+
+    int attach(ReceiptSink *sink);
+    void write(const ReceiptLine &line);
+
+private:
+    ReceiptSink *_sinks[RECEIPT_OUTPUT_SINKS];
+    int _count;
+};
+
+#endif /* !RECEIPT_LINE_H_ */
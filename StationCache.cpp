@@ -0,0 +1,151 @@
+/* Cache of resolved station names
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+
+#include "StationCache.h"
+
+/* --------------------------------
+ * Constant
+ * -------------------------------- */
+
+#define ENTRY_BUS                     0x01
+#define ENTRY_REFERENCED              0x02
+#define ENTRY_NOT_FOUND               0x80
+
+/* --------------------------------
+ * Function
+ * -------------------------------- */
+
+/* ------------------------
+ * public
+ * ------------------------ */
+
+StationCache::StationCache() :
+    _count(0),
+    _hand(0),
+    _generation(0),
+    _hits(0),
+    _misses(0)
+{
+}
+
+int StationCache::find(StationDB *db, uint32_t generation, int area, int line, int station,
+                       const char **line_name, const char **name)
+{
+    uint32_t key = STATION_CACHE_KEY(area, line, station);
+    station_ref ref;
+
+    update(generation);
+    int ret = lookup(key, 0, line_name, name);
+    if (ret >= 0) {
+        _hits++;
+        return ret;
+    }
+
+    _misses++;
+    ret = db->find(area, line, station, &ref);
+    return insert(db, key, 0, ret, ref, line_name, name);
+}
+
+int StationCache::findBus(StationDB *db, uint32_t generation, int code, int stop,
+                          const char **line_name, const char **name)
+{
+    uint32_t key = STATION_CACHE_BUS_KEY(code, stop);
+    station_ref ref;
+
+    update(generation);
+    int ret = lookup(key, ENTRY_BUS, line_name, name);
+    if (ret >= 0) {
+        _hits++;
+        return ret;
+    }
+
+    _misses++;
+    ret = db->findBus(code, stop, &ref);
+    return insert(db, key, ENTRY_BUS, ret, ref, line_name, name);
+}
+
+void StationCache::clear(void)
+{
+    _count = 0;
+    _hand = 0;
+}
+
+uint32_t StationCache::hits(void) const
+{
+    return _hits;
+}
+
+uint32_t StationCache::misses(void) const
+{
+    return _misses;
+}
+
+/* ------------------------
+ * private
+ * ------------------------ */
+
+/* 1: cached hit, 0: cached miss, -1: not cached */
+int StationCache::lookup(uint32_t key, uint8_t kind, const char **line_name, const char **name)
+{
+    for (int i = 0; i < _count; i++) {
+        if ((_keys[i] == key) && ((_flags[i] & ENTRY_BUS) == kind)) {
+            _flags[i] |= ENTRY_REFERENCED;
+            if (_flags[i] & ENTRY_NOT_FOUND) {
+                return 0;
+            }
+            *line_name = _entries[i].line_name;
+            *name = _entries[i].name;
+            return 1;
+        }
+    }
+    return -1;
+}
+
+/* stores the result of a database lookup, returns found */
+int StationCache::insert(StationDB *db, uint32_t key, uint8_t kind, int found, const station_ref &ref,
+                         const char **line_name, const char **name)
+{
+    int i;
+    if (_count < STATION_CACHE_SIZE) {
+        i = _count++;
+    }
+    else {
+        // clock: skip entries hit since the hand last passed them
+        while (_flags[_hand] & ENTRY_REFERENCED) {
+            _flags[_hand] &= ~ENTRY_REFERENCED;
+            _hand = (_hand + 1) % STATION_CACHE_SIZE;
+        }
+        i = _hand;
+        _hand = (_hand + 1) % STATION_CACHE_SIZE;
+    }
+
+    _keys[i] = key;
+    _flags[i] = kind | (found ? 0 : ENTRY_NOT_FOUND);
+    if (!found) {
+        return 0;
+    }
+
+    entry *e = &_entries[i];
+    const char *station_name = db->stationName(ref);
+    size_t len = strlen(station_name);
+    if (len > sizeof(e->name) - 1) {
+        len = sizeof(e->name) - 1;
+    }
+    memcpy(e->name, station_name, len);
+    e->name[len] = '\0';
+    e->line_name = db->lineName(ref);
+    *line_name = e->line_name;
+    *name = e->name;
+    return 1;
+}
+
+void StationCache::update(uint32_t generation)
+{
+    if (generation != _generation) {
+        clear();
+        _generation = generation;
+    }
+}
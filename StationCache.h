@@ -0,0 +1,77 @@
+/* Cache of resolved station names
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef STATION_CACHE_H_
+#define STATION_CACHE_H_
+
+#include <stdint.h>
+
+#include "StationDB.h"
+
+/* --------------------------------
+ * Constant
+ * -------------------------------- */
+
+#ifndef STATION_CACHE_SIZE
+#define STATION_CACHE_SIZE            8
+#endif
+
+#define STATION_CACHE_KEY(area, line, station) \
+    (((uint32_t)(area) << 16) | ((uint32_t)(line) << 8) | (uint32_t)(station))
+#define STATION_CACHE_BUS_KEY(code, stop) \
+    (((uint32_t)(code) << 16) | (uint32_t)(stop))
+
+/* --------------------------------
+ * Class Declaration
+ * -------------------------------- */
+
+/*
+ * Fixed-capacity cache of station and bus lookups. An entry holds the
+ * resolved names: the line name points into the line pool, which stays
+ * in RAM while the database is loaded, and the station name is copied,
+ * since a file backed database returns it from its page cache. A hit
+ * therefore reads nothing from the database. The returned names stay
+ * valid until the next find() or findBus() on the same cache.
+ * Lookups that failed are cached as well. The keys are kept apart from
+ * the names so a lookup scans one small array, and a full cache evicts
+ * with a clock hand instead of reordering entries. hits() and misses()
+ * are sent to the host with the timeline ('t').
+ * The cache is flushed when the database generation changes.
+ */
+class StationCache
+{
+public:
+    StationCache();
+
+    int find(StationDB *db, uint32_t generation, int area, int line, int station,
+             const char **line_name, const char **name);
+    int findBus(StationDB *db, uint32_t generation, int code, int stop,
+                const char **line_name, const char **name);
+    void clear(void);
+
+    uint32_t hits(void) const;
+    uint32_t misses(void) const;
+
+private:
+    struct entry {
+        const char *line_name;
+        char name[STATION_DB_NAME_MAX];
+    };
+
+    int lookup(uint32_t key, uint8_t kind, const char **line_name, const char **name);
+    int insert(StationDB *db, uint32_t key, uint8_t kind, int found, const station_ref &ref,
+               const char **line_name, const char **name);
+    void update(uint32_t generation);
+
+    int _count;
+    int _hand;
+    uint32_t _generation;
+    uint32_t _hits;
+    uint32_t _misses;
+    uint32_t _keys[STATION_CACHE_SIZE];         // what a lookup reads ends here
+    uint8_t _flags[STATION_CACHE_SIZE];
+    entry _entries[STATION_CACHE_SIZE];
+};
+
+#endif /* !STATION_CACHE_H_ */
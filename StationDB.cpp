@@ -0,0 +1,440 @@
+/* Compact station code database
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <new>
+
+#include "StationDB.h"
+
+/* --------------------------------
+ * Macro
+ * -------------------------------- */
+
+#define RUN_KEY(area, line, station) \
+    (((uint32_t)(area) << 16) | ((uint32_t)(line) << 8) | (uint32_t)(station))
+#define BUS_KEY(code, stop) \
+    (((uint32_t)(code) << 16) | (uint32_t)(stop))
+
+/* --------------------------------
+ * Function
+ * -------------------------------- */
+
+static uint32_t crc32(uint32_t crc, const uint8_t *data, uint32_t len)
+{
+    crc = ~crc;
+    for (uint32_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+/* ------------------------
+ * public
+ * ------------------------ */
+
+StationDB::StationDB() :
+    _header(NULL),
+    _runs(NULL),
+    _codes(NULL),
+    _names(NULL),
+    _buses(NULL),
+    _station_index(NULL),
+    _line_index(NULL),
+    _line_pool(NULL),
+    _name_pool(NULL),
+    _reader(NULL),
+    _index(NULL),
+    _pages(NULL),
+    _clock(0)
+{
+}
+
+StationDB::~StationDB()
+{
+    close();
+}
+
+int StationDB::open(const uint8_t *image, uint32_t size)
+{
+    if ((image == NULL) || (size < sizeof(station_db_header)) ||
+        !checkHeader((const station_db_header *)image, size)) {
+        return 0;
+    }
+
+    close();
+    attach(image);
+    _name_pool = (const char *)(image + _header->name_pool_offset);
+
+    return 1;
+}
+
+int StationDB::open(StationDBReader *reader)
+{
+    station_db_header header;
+
+    if ((reader == NULL) ||
+        !reader->read(0, &header, sizeof(header)) ||
+        !checkHeader(&header, 0xFFFFFFFF)) {
+        return 0;
+    }
+
+    /* header and index sections go to RAM, the name pool stays behind the reader */
+    uint8_t *index = new (std::nothrow) uint8_t[header.name_pool_offset];
+    station_db_page *pages = new (std::nothrow) station_db_page[STATION_DB_CACHE_PAGES];
+    if ((index == NULL) || (pages == NULL) ||
+        !reader->read(0, index, header.name_pool_offset)) {
+        delete[] index;
+        delete[] pages;
+        return 0;
+    }
+
+    /* verify the whole image before it is used */
+    uint32_t crc = crc32(0, index + sizeof(header), header.name_pool_offset - sizeof(header));
+    for (uint32_t offset = 0; offset < header.name_pool_size; offset += STATION_DB_PAGE_SIZE) {
+        uint32_t len = header.name_pool_size - offset;
+        if (len > STATION_DB_PAGE_SIZE) {
+            len = STATION_DB_PAGE_SIZE;
+        }
+        if (!reader->read(header.name_pool_offset + offset, pages[0].data, len)) {
+            crc = ~header.crc;
+            break;
+        }
+        crc = crc32(crc, (const uint8_t *)pages[0].data, len);
+    }
+    if (crc != header.crc) {
+        delete[] index;
+        delete[] pages;
+        return 0;
+    }
+
+    close();
+    attach(index);
+    _reader = reader;
+    _index = index;
+    _pages = pages;
+    for (int i = 0; i < STATION_DB_CACHE_PAGES; i++) {
+        _pages[i].number = 0xFFFFFFFF;
+        _pages[i].used = 0;
+    }
+
+    return 1;
+}
+
+void StationDB::close(void)
+{
+    delete[] _index;
+    delete[] _pages;
+
+    _header = NULL;
+    _runs = NULL;
+    _codes = NULL;
+    _names = NULL;
+    _buses = NULL;
+    _station_index = NULL;
+    _line_index = NULL;
+    _line_pool = NULL;
+    _name_pool = NULL;
+    _reader = NULL;
+    _index = NULL;
+    _pages = NULL;
+}
+
+int StationDB::find(int area, int line, int station, station_ref *ref) const
+{
+    if (_header == NULL) {
+        return 0;
+    }
+
+    /* last run that starts at or before the key */
+    uint32_t key = RUN_KEY(area, line, station);
+    int lo = 0;
+    int hi = _header->run_count - 1;
+    int run = -1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        if (RUN_KEY(_runs[mid].area, _runs[mid].line, _runs[mid].station) <= key) {
+            run = mid;
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    if ((run < 0) || (_runs[run].area != area) || (_runs[run].line != line)) {
+        return 0;
+    }
+
+    /* station code within the run */
+    lo = _runs[run].first;
+    hi = ((run + 1) < _header->run_count ? _runs[run + 1].first : _header->station_count) - 1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        if (_codes[mid] == station) {
+            ref->line_name = _runs[run].line_name;
+            ref->name = nameOffset(mid);
+            return 1;
+        } else if (_codes[mid] < station) {
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+
+    return 0;
+}
+
+/* operator name, and the stop name when the stop is known */
+int StationDB::findBus(int code, int stop, station_ref *ref) const
+{
+    if (_header == NULL) {
+        return 0;
+    }
+
+    uint32_t key = BUS_KEY(code, stop);
+    int lo = 0;
+    int hi = _header->bus_count - 1;
+    int found = -1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        uint32_t k = BUS_KEY(_buses[mid].code, _buses[mid].stop);
+        if (k == key) {
+            found = mid;
+            break;
+        } else if (k < key) {
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    if (found >= 0) {
+        ref->line_name = _buses[found].line_name;
+        ref->name = _buses[found].name;
+        return 1;
+    }
+    if (stop != STATION_DB_ANY_STOP) {
+        return findBus(code, STATION_DB_ANY_STOP, ref);
+    }
+
+    return 0;
+}
+
+const char *StationDB::lineName(const station_ref &ref) const
+{
+    return _line_pool + ref.line_name;
+}
+
+const char *StationDB::stationName(const station_ref &ref)
+{
+    if (ref.name == STATION_DB_NO_NAME) {
+        return "";
+    }
+    return name(ref.name);
+}
+
+/*
+ * Stations named key, or whose name starts with key (STATION_DB_PREFIX),
+ * in name order. Up to max codes are stored; the return value is the
+ * number of matches, which may be larger.
+ */
+int StationDB::findName(const char *key, int match, station_code *codes, int max)
+{
+    if (_header == NULL) {
+        return 0;
+    }
+
+    size_t len = strlen(key) + ((match == STATION_DB_PREFIX) ? 0 : 1);
+    int lo = 0;
+    int hi = _header->station_count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (strncmp(name(nameOffset(_station_index[mid])), key, len) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    int found = 0;
+    for (int i = lo; i < _header->station_count; i++) {
+        int index = _station_index[i];
+        if (strncmp(name(nameOffset(index)), key, len) != 0) {
+            break;
+        }
+        if (found < max) {
+            const station_db_run &run = _runs[runOf(index)];
+            codes[found].area = run.area;
+            codes[found].line = run.line;
+            codes[found].station = _codes[index];
+        }
+        found++;
+    }
+
+    return found;
+}
+
+/* same for line names; a match is reported with the first station of the line */
+int StationDB::findLineName(const char *key, int match, station_code *codes, int max) const
+{
+    if (_header == NULL) {
+        return 0;
+    }
+
+    size_t len = strlen(key) + ((match == STATION_DB_PREFIX) ? 0 : 1);
+    int lo = 0;
+    int hi = _header->run_count;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (strncmp(_line_pool + _runs[_line_index[mid]].line_name, key, len) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    int found = 0;
+    for (int i = lo; i < _header->run_count; i++) {
+        const station_db_run &run = _runs[_line_index[i]];
+        if (strncmp(_line_pool + run.line_name, key, len) != 0) {
+            break;
+        }
+        if (found < max) {
+            codes[found].area = run.area;
+            codes[found].line = run.line;
+            codes[found].station = run.station;
+        }
+        found++;
+    }
+
+    return found;
+}
+
+uint16_t StationDB::count(void) const
+{
+    return (_header != NULL) ? _header->station_count : 0;
+}
+
+uint16_t StationDB::encoding(void) const
+{
+    return (_header != NULL) ? _header->encoding : STATION_DB_UTF8;
+}
+
+uint32_t StationDB::crc(void) const
+{
+    return (_header != NULL) ? _header->crc : 0;
+}
+
+int StationDB::checkHeader(const station_db_header *header, uint32_t size)
+{
+    /* sums in 64 bits: a reader-backed image passes size 0xFFFFFFFF */
+    if ((header->magic != STATION_DB_MAGIC) ||
+        (header->version != STATION_DB_VERSION) ||
+        (header->run_count == 0) ||
+        (header->run_offset < sizeof(station_db_header)) ||
+        ((uint64_t)header->run_offset + header->run_count * sizeof(station_db_run) > header->code_offset) ||
+        ((uint64_t)header->code_offset + header->station_count > header->name_offset) ||
+        ((uint64_t)header->name_offset + header->station_count * 3 > header->bus_offset) ||
+        ((uint64_t)header->bus_offset + header->bus_count * sizeof(station_db_bus) > header->station_index_offset) ||
+        ((uint64_t)header->station_index_offset + header->station_count * sizeof(uint16_t) > header->line_index_offset) ||
+        ((uint64_t)header->line_index_offset + header->run_count * sizeof(uint16_t) > header->line_pool_offset) ||
+        ((uint64_t)header->line_pool_offset + header->line_pool_size > header->name_pool_offset) ||
+        ((uint64_t)header->name_pool_offset + header->name_pool_size > size)) {
+        return 0;
+    }
+
+    return 1;
+}
+
+/* ------------------------
+ * private
+ * ------------------------ */
+
+void StationDB::attach(const uint8_t *image)
+{
+    _header = (const station_db_header *)image;
+    _runs = (const station_db_run *)(image + _header->run_offset);
+    _codes = image + _header->code_offset;
+    _names = image + _header->name_offset;
+    _buses = (const station_db_bus *)(image + _header->bus_offset);
+    _station_index = (const uint16_t *)(image + _header->station_index_offset);
+    _line_index = (const uint16_t *)(image + _header->line_index_offset);
+    _line_pool = (const char *)(image + _header->line_pool_offset);
+}
+
+station_db_page *StationDB::fetch(uint32_t number)
+{
+    station_db_page *victim = &_pages[0];
+
+    if ((uint64_t)number * STATION_DB_PAGE_SIZE >= _header->name_pool_size) {
+        return NULL;
+    }
+
+    _clock++;
+    for (int i = 0; i < STATION_DB_CACHE_PAGES; i++) {
+        if (_pages[i].number == number) {
+            _pages[i].used = _clock;
+            return &_pages[i];
+        }
+        if (_pages[i].used < victim->used) {
+            victim = &_pages[i];
+        }
+    }
+
+    /* a page also holds the head of the next one, so no name is split */
+    uint32_t offset = number * STATION_DB_PAGE_SIZE;
+    uint32_t len = _header->name_pool_size - offset;
+    if (len > sizeof(victim->data) - 1) {
+        len = sizeof(victim->data) - 1;
+    }
+    if (!_reader->read(_header->name_pool_offset + offset, victim->data, len)) {
+        victim->number = 0xFFFFFFFF;
+        victim->used = 0;
+        return NULL;
+    }
+    victim->data[len] = '\0';
+    victim->number = number;
+    victim->used = _clock;
+
+    return victim;
+}
+
+const char *StationDB::name(uint32_t offset)
+{
+    if (offset >= _header->name_pool_size) {
+        return "";
+    }
+    if (_name_pool != NULL) {
+        return _name_pool + offset;
+    }
+
+    station_db_page *page = fetch(offset / STATION_DB_PAGE_SIZE);
+    if (page == NULL) {
+        return "";
+    }
+    return page->data + (offset % STATION_DB_PAGE_SIZE);
+}
+
+/* name pool offset of the station with the given index, 24-bit little endian */
+uint32_t StationDB::nameOffset(int index) const
+{
+    const uint8_t *p = &_names[index * 3];
+    return p[0] | (p[1] << 8) | ((uint32_t)p[2] << 16);
+}
+
+/* run that holds the station with the given index */
+int StationDB::runOf(int index) const
+{
+    int lo = 0;
+    int hi = _header->run_count - 1;
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if (_runs[mid].first <= index) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return lo;
+}
@@ -0,0 +1,187 @@
+/* Compact station code database
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef STATION_DB_H_
+#define STATION_DB_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* --------------------------------
+ * Constant
+ * -------------------------------- */
+
+#define STATION_DB_MAGIC              0x42444353  // "SCDB"
+#define STATION_DB_VERSION            4
+#define STATION_DB_NAME_MAX           64          // longest name including NUL
+#define STATION_DB_NO_NAME            0xFFFFFF    // station_ref without a name
+#define STATION_DB_NAME_POOL_MAX      0xFFFFFF    // name offsets are 24 bits, the last one means no name
+#define STATION_DB_ANY_STOP           0xFFFF      // bus entry for the operator itself
+
+/* name queries */
+#define STATION_DB_EXACT              0
+#define STATION_DB_PREFIX             1
+
+/* station_db_header.encoding */
+#define STATION_DB_UTF8               0
+#define STATION_DB_SJIS               1           // Shift_JIS (CP932), for the printer
+
+/* page cache for images opened through a StationDBReader */
+#ifndef STATION_DB_PAGE_SIZE
+#define STATION_DB_PAGE_SIZE          256
+#endif
+#ifndef STATION_DB_CACHE_PAGES
+#define STATION_DB_CACHE_PAGES        4
+#endif
+
+/* --------------------------------
+ * Image layout
+ * --------------------------------
+ *
+ * All multi-byte fields are little endian and every section starts on a
+ * 4-byte boundary, so the image can be used in place from flash.
+ *
+ *   header
+ *   run table      run_count entries, sorted by (area, line, station)
+ *   station codes  station_count x uint8_t, sorted within each run
+ *   station names  station_count x 3 bytes, offsets into the name pool
+ *   bus table      bus_count entries, sorted by (operator, stop)
+ *   station index  station_count x uint16_t, stations sorted by name
+ *   line index     run_count x uint16_t, runs sorted by line name
+ *   line pool      interned line and bus operator names, NUL terminated
+ *   name pool      interned station and bus stop names, NUL terminated
+ *
+ * A run is a sequence of stations that share area code, line code and
+ * line name, so the line name is stored once per run instead of once
+ * per station.
+ *
+ * Bus and tram records carry an operator code and a stop code instead of
+ * line and station codes. An entry with stop STATION_DB_ANY_STOP names
+ * the operator, the others name single stops.
+ *
+ * The two indexes list stations and runs in byte order of their names,
+ * so names and name prefixes are found by binary search.
+ */
+
+struct station_db_header {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t run_count;
+    uint16_t station_count;
+    uint16_t line_pool_size;
+    uint32_t name_pool_size;
+    uint32_t run_offset;
+    uint32_t code_offset;
+    uint32_t name_offset;
+    uint32_t line_pool_offset;
+    uint32_t name_pool_offset;
+    uint16_t bus_count;
+    uint16_t encoding;          // encoding of the name pools
+    uint32_t bus_offset;
+    uint32_t station_index_offset;
+    uint32_t line_index_offset;
+    uint32_t crc;               // CRC-32 of everything after the header
+};
+
+struct station_db_run {
+    uint8_t area;
+    uint8_t line;
+    uint8_t station;            // first station code in the run
+    uint8_t reserved;
+    uint16_t first;             // index of the first station in the run
+    uint16_t line_name;         // offset into the line pool
+};
+
+struct station_db_bus {
+    uint16_t code;              // operator code
+    uint16_t stop;              // stop code or STATION_DB_ANY_STOP
+    uint16_t line_name;         // operator name, offset into the line pool
+    uint16_t reserved;
+    uint32_t name;              // stop name, offset into the name pool
+};
+
+struct station_code {
+    uint8_t area;
+    uint8_t line;
+    uint8_t station;
+};
+
+struct station_ref {
+    uint16_t line_name;         // offset into the line pool
+    uint32_t name;              // offset into the name pool
+};
+
+struct station_db_page {
+    uint32_t number;
+    uint32_t used;
+    char data[STATION_DB_PAGE_SIZE + STATION_DB_NAME_MAX];
+};
+
+/* --------------------------------
+ * Class Declaration
+ * -------------------------------- */
+
+/* random access to an image that is not memory mapped (file, SPI flash) */
+class StationDBReader
+{
+public:
+    virtual ~StationDBReader() {}
+    virtual int read(uint32_t offset, void *buf, uint32_t len) = 0;
+};
+
+/*
+ * An image is either used in place (open(image, size)) or read through a
+ * StationDBReader. In the latter case everything except the name pool is
+ * copied to RAM, and station names are read through a small page cache.
+ * The pointer returned by stationName() then stays valid until the next
+ * call to stationName().
+ */
+class StationDB
+{
+public:
+    StationDB();
+    ~StationDB();
+
+    int open(const uint8_t *image, uint32_t size);
+    int open(StationDBReader *reader);
+    void close(void);
+
+    int find(int area, int line, int station, station_ref *ref) const;
+    int findBus(int code, int stop, station_ref *ref) const;
+    const char *lineName(const station_ref &ref) const;
+    const char *stationName(const station_ref &ref);
+
+    int findName(const char *key, int match, station_code *codes, int max);
+    int findLineName(const char *key, int match, station_code *codes, int max) const;
+
+    uint16_t count(void) const;
+    uint16_t encoding(void) const;
+    uint32_t crc(void) const;
+
+    static int checkHeader(const station_db_header *header, uint32_t size);
+
+private:
+    void attach(const uint8_t *image);
+    station_db_page *fetch(uint32_t number);
+    const char *name(uint32_t offset);
+    uint32_t nameOffset(int index) const;
+    int runOf(int index) const;
+
+    const station_db_header *_header;
+    const station_db_run *_runs;
+    const uint8_t *_codes;
+    const uint8_t *_names;
+    const station_db_bus *_buses;
+    const uint16_t *_station_index;
+    const uint16_t *_line_index;
+    const char *_line_pool;
+    const char *_name_pool;
+
+    StationDBReader *_reader;
+    uint8_t *_index;
+    station_db_page *_pages;
+    uint32_t _clock;
+};
+
+#endif /* !STATION_DB_H_ */
@@ -0,0 +1,185 @@
+/* Station database on a file system or block device
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <new>
+
+#include "StationDBFile.h"
+
+/* --------------------------------
+ * Function
+ * -------------------------------- */
+
+/* ------------------------
+ * FileStationDBReader
+ * ------------------------ */
+
+FileStationDBReader::FileStationDBReader(const char *path) :
+    _fp(fopen(path, "rb"))
+{
+}
+
+FileStationDBReader::~FileStationDBReader()
+{
+    if (_fp != NULL) {
+        fclose(_fp);
+    }
+}
+
+int FileStationDBReader::read(uint32_t offset, void *buf, uint32_t len)
+{
+    if ((_fp == NULL) ||
+        (fseek(_fp, (long)offset, SEEK_SET) != 0) ||
+        (fread(buf, 1, len, _fp) != len)) {
+        return 0;
+    }
+
+    return 1;
+}
+
+#if STATION_DB_BLOCK_DEVICE
+
+/* ------------------------
+ * BlockDeviceStationDBReader
+ * ------------------------ */
+
+BlockDeviceStationDBReader::BlockDeviceStationDBReader(StationDBBlockDevice *bd, station_bd_addr_t base) :
+    _bd(bd),
+    _base(base),
+    _bounce(NULL)
+{
+    if (_bd->get_read_size() > 1) {
+        _bounce = new (std::nothrow) uint8_t[_bd->get_read_size()];
+    }
+}
+
+BlockDeviceStationDBReader::~BlockDeviceStationDBReader()
+{
+    delete[] _bounce;
+}
+
+int BlockDeviceStationDBReader::read(uint32_t offset, void *buf, uint32_t len)
+{
+    uint8_t *dst = (uint8_t *)buf;
+    uint32_t unit = (uint32_t)_bd->get_read_size();
+    station_bd_addr_t addr = _base + offset;
+
+    if (unit <= 1) {
+        return _bd->read(buf, addr, len) == 0;
+    }
+    if (_bounce == NULL) {
+        return 0;
+    }
+
+    /* the device only reads whole read units */
+    while (len > 0) {
+        uint32_t skip = (uint32_t)(addr % unit);
+        uint32_t n;
+        if ((skip == 0) && (len >= unit)) {
+            n = len - (len % unit);
+            if (_bd->read(dst, addr, n) != 0) {
+                return 0;
+            }
+        } else {
+            n = unit - skip;
+            if (n > len) {
+                n = len;
+            }
+            if (_bd->read(_bounce, addr - skip, unit) != 0) {
+                return 0;
+            }
+            memcpy(dst, _bounce + skip, n);
+        }
+        dst += n;
+        addr += n;
+        len -= n;
+    }
+
+    return 1;
+}
+
+#endif
+
+/* ------------------------
+ * StationDBSlot
+ * ------------------------ */
+
+StationDBSlot::StationDBSlot() :
+    _active(0),
+    _generation(0)
+{
+    _reader[0] = NULL;
+    _reader[1] = NULL;
+}
+
+StationDBSlot::~StationDBSlot()
+{
+    _db[0].close();
+    _db[1].close();
+    delete _reader[0];
+    delete _reader[1];
+}
+
+int StationDBSlot::load(const uint8_t *image, uint32_t size)
+{
+    int spare = _active ^ 1;
+
+    if (!_db[spare].open(image, size)) {
+        return 0;
+    }
+    activate(spare, NULL);
+
+    return 1;
+}
+
+int StationDBSlot::load(StationDBReader *reader)
+{
+    int spare = _active ^ 1;
+
+    if (!_db[spare].open(reader)) {
+        delete reader;
+        return 0;
+    }
+    activate(spare, reader);
+
+    return 1;
+}
+
+StationDB *StationDBSlot::lock(void)
+{
+    _mutex.lock();
+    return &_db[_active];
+}
+
+void StationDBSlot::unlock(void)
+{
+    _mutex.unlock();
+}
+
+uint32_t StationDBSlot::generation(void) const
+{
+    return _generation;
+}
+
+/* ------------------------
+ * private
+ * ------------------------ */
+
+void StationDBSlot::activate(int spare, StationDBReader *reader)
+{
+    int retired;
+
+    _reader[spare] = reader;
+
+    _mutex.lock();
+    retired = _active;
+    _active = spare;
+    _generation++;
+    _mutex.unlock();
+
+    /* nobody can hold the retired database any more */
+    _db[retired].close();
+    delete _reader[retired];
+    _reader[retired] = NULL;
+}
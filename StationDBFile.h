@@ -0,0 +1,94 @@
+/* Station database on a file system or block device
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef STATION_DB_FILE_H_
+#define STATION_DB_FILE_H_
+
+#include <stdio.h>
+
+#include "StationDB.h"
+
+#if defined(__MBED__)
+#include "platform/PlatformMutex.h"
+#if defined(STATION_DB_FILE) || defined(STATION_DB_ADDRESS)
+#define STATION_DB_BLOCK_DEVICE       1
+#include "blockdevice/BlockDevice.h"
+typedef mbed::BlockDevice StationDBBlockDevice;
+typedef mbed::bd_addr_t station_bd_addr_t;
+#endif
+#else
+#include <mutex>
+#define STATION_DB_BLOCK_DEVICE       1
+#include "FileBlockDevice.h"        // host stand-in, see tools/
+typedef std::mutex PlatformMutex;
+typedef FileBlockDevice StationDBBlockDevice;
+typedef bd_addr_t station_bd_addr_t;
+#endif
+
+/* --------------------------------
+ * Class Declaration
+ * -------------------------------- */
+
+/* image stored as a file, e.g. on a LittleFS partition */
+class FileStationDBReader : public StationDBReader
+{
+public:
+    FileStationDBReader(const char *path);
+    ~FileStationDBReader();
+
+    int read(uint32_t offset, void *buf, uint32_t len);
+
+private:
+    FILE *_fp;
+};
+
+#if STATION_DB_BLOCK_DEVICE
+/* image stored raw at a fixed address of a block device (SPI flash) */
+class BlockDeviceStationDBReader : public StationDBReader
+{
+public:
+    BlockDeviceStationDBReader(StationDBBlockDevice *bd, station_bd_addr_t base = 0);
+    ~BlockDeviceStationDBReader();
+
+    int read(uint32_t offset, void *buf, uint32_t len);
+
+private:
+    StationDBBlockDevice *_bd;
+    station_bd_addr_t _base;
+    uint8_t *_bounce;
+};
+#endif
+
+/*
+ * Holds the active station database and swaps in a new image at runtime.
+ * A new image is opened and verified in the spare slot first, so lookups
+ * keep using the old one until the switch, which happens under the lock.
+ * Lookups must hold the lock (lock()/unlock()) while they use the returned
+ * database. Only one load() may run at a time.
+ */
+class StationDBSlot
+{
+public:
+    StationDBSlot();
+    ~StationDBSlot();
+
+    int load(const uint8_t *image, uint32_t size);
+    int load(StationDBReader *reader);      // takes ownership of reader
+
+    StationDB *lock(void);
+    void unlock(void);
+
+    uint32_t generation(void) const;
+
+private:
+    void activate(int spare, StationDBReader *reader);
+
+    StationDB _db[2];
+    StationDBReader *_reader[2];
+    int _active;
+    uint32_t _generation;
+    PlatformMutex _mutex;
+};
+
+#endif /* !STATION_DB_FILE_H_ */
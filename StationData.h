@@ -0,0 +1,25 @@
+/* Built-in station database images
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef STATION_DATA_H_
+#define STATION_DATA_H_
+
+/* --------------------------------
+ * Constant
+ * -------------------------------- */
+
+/*
+ * Defined in StationData.S, which embeds the generated images with
+ * .incbin, so the C++ compiler never parses them.
+ */
+extern "C" {
+extern const unsigned char sc_compact[];
+extern const unsigned int sc_compact_len;
+#if STATION_DATA_LEGACY
+extern const unsigned char sc_utf8[];       // legacy fixed-record table, host tools only
+extern const unsigned int sc_utf8_len;
+#endif
+}
+
+#endif /* !STATION_DATA_H_ */
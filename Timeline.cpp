@@ -0,0 +1,188 @@
+/* Per-tap stage timeline
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "Timeline.h"
+
+/* --------------------------------
+ * Constant
+ * -------------------------------- */
+
+#define RING_SIZE                     ((TIMELINE_ENTRIES > 0) ? TIMELINE_ENTRIES : 1)
+
+static const char *const stage_names[TIMELINE_STAGES] = {
+    "tap", "poll", "probe", "read", "station", "format", "lcd", "usb", "printer"
+};
+
+/* --------------------------------
+ * Function
+ * -------------------------------- */
+
+Timeline::Timeline(uint32_t (*clock)(void)) :
+    _clock(clock),
+    _start(0),
+    _tap(0),
+    _depth(0),
+    _used(0),
+    _head(0),
+    _count(0),
+    _overflows(0)
+{
+}
+
+void Timeline::begin(void)
+{
+    if (TIMELINE_ENTRIES == 0) {
+        return;
+    }
+    _start = _clock();
+    _used = 1;
+    _current[0].stage = TIMELINE_TAP;
+    _current[0].depth = 0;
+    _current[0].start = 0;
+    _current[0].duration = 0;
+    _depth = 1;
+}
+
+int Timeline::open(int stage)
+{
+    if ((TIMELINE_ENTRIES == 0) || (_used == 0)) {
+        return -1;
+    }
+    if (_used == TIMELINE_TAP_ENTRIES) {
+        _overflows++;
+        _depth++;
+        return -1;
+    }
+    timeline_entry *e = &_current[_used];
+    e->stage = (uint8_t)stage;
+    e->depth = (uint8_t)_depth;
+    e->start = _clock() - _start;
+    e->duration = 0;
+    _depth++;
+    return _used++;
+}
+
+void Timeline::close(int slot)
+{
+    if (_depth > 1) {
+        _depth--;
+    }
+    if (slot > 0) {
+        _current[slot].duration = _clock() - _start - _current[slot].start;
+    }
+}
+
+/* frees the oldest tap of the ring */
+void Timeline::drop_tap(void)
+{
+    int tail = (_head + RING_SIZE - _count) % RING_SIZE;
+    uint16_t tap = _ring[tail].tap;
+
+    while ((_count > 0) && (_ring[tail].tap == tap)) {
+        tail = (tail + 1) % RING_SIZE;
+        _count--;
+    }
+}
+
+void Timeline::commit(void)
+{
+    if ((TIMELINE_ENTRIES == 0) || (_used == 0)) {
+        return;
+    }
+    _current[0].duration = _clock() - _start;
+    _tap++;
+
+    int n = (_used < RING_SIZE) ? _used : RING_SIZE;
+    while (RING_SIZE - _count < n) {
+        drop_tap();
+    }
+    for (int i = 0; i < n; i++) {
+        _ring[_head] = _current[i];
+        _ring[_head].tap = _tap;
+        _head = (_head + 1) % RING_SIZE;
+    }
+    _count += n;
+    _used = 0;
+}
+
+int Timeline::entries(void) const
+{
+    return _count;
+}
+
+int Timeline::read(int index, timeline_entry *entry) const
+{
+    if ((index < 0) || (index >= _count)) {
+        return 0;
+    }
+    *entry = _ring[(_head + RING_SIZE - _count + index) % RING_SIZE];
+    return 1;
+}
+
+uint32_t Timeline::overflows(void) const
+{
+    return _overflows;
+}
+
+const char *timeline_stage_name(int stage)
+{
+    if ((stage < 0) || (stage >= TIMELINE_STAGES)) {
+        return "unknown";
+    }
+    return stage_names[stage];
+}
+
+static void put32(uint8_t *p, uint32_t v)
+{
+    for (int i = 0; i < 4; i++) {
+        p[i] = (uint8_t)(v >> (i * 8));
+    }
+}
+
+static uint32_t get32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+int timeline_pack(const timeline_entry *entries, int count, int first, uint8_t *payload)
+{
+    if (count > TIMELINE_FRAME_ENTRIES) {
+        count = TIMELINE_FRAME_ENTRIES;
+    }
+    payload[0] = (uint8_t)(entries[0].tap & 0xFF);
+    payload[1] = (uint8_t)(entries[0].tap >> 8);
+    payload[2] = (uint8_t)first;
+
+    uint8_t *p = payload + TIMELINE_FRAME_HEADER;
+    for (int i = 0; i < count; i++) {
+        p[0] = entries[i].stage;
+        p[1] = entries[i].depth;
+        put32(&p[2], entries[i].start);
+        put32(&p[6], entries[i].duration);
+        p += TIMELINE_FRAME_ENTRY;
+    }
+    return TIMELINE_FRAME_HEADER + count * TIMELINE_FRAME_ENTRY;
+}
+
+int timeline_unpack(const uint8_t *payload, int len, int *first, timeline_entry *entries)
+{
+    len -= TIMELINE_FRAME_HEADER;
+    if ((len < 0) || ((len % TIMELINE_FRAME_ENTRY) != 0) || (len > TIMELINE_FRAME_ENTRIES * TIMELINE_FRAME_ENTRY)) {
+        return -1;
+    }
+    uint16_t tap = (uint16_t)(payload[0] | (payload[1] << 8));
+    *first = payload[2];
+
+    const uint8_t *p = payload + TIMELINE_FRAME_HEADER;
+    int count = len / TIMELINE_FRAME_ENTRY;
+    for (int i = 0; i < count; i++) {
+        entries[i].stage = p[0];
+        entries[i].depth = p[1];
+        entries[i].tap = tap;
+        entries[i].start = get32(&p[2]);
+        entries[i].duration = get32(&p[6]);
+        p += TIMELINE_FRAME_ENTRY;
+    }
+    return count;
+}
@@ -0,0 +1,124 @@
+/* Per-tap stage timeline
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef TIMELINE_H_
+#define TIMELINE_H_
+
+#include <stdint.h>
+
+/* --------------------------------
+ * Constant
+ * -------------------------------- */
+
+/* entries kept for the host (timeline-entries), 0 compiles the markers out */
+#ifndef TIMELINE_ENTRIES
+#define TIMELINE_ENTRIES              128
+#endif
+#define TIMELINE_TAP_ENTRIES          48          // most entries one polling cycle keeps
+
+/* stages */
+#define TIMELINE_TAP                  0           // the whole polling cycle
+#define TIMELINE_POLL                 1           // polling, RF off
+#define TIMELINE_PROBE                2           // requestService
+#define TIMELINE_READ                 3           // readEncryption
+#define TIMELINE_STATION              4           // station and bus stop lookup
+#define TIMELINE_FORMAT               5           // history lines, includes lookups and output
+#define TIMELINE_LCD                  6
+#define TIMELINE_USB                  7
+#define TIMELINE_PRINTER              8
+#define TIMELINE_STAGES               9
+
+/* EVENT_TIMELINE payload: tap(2, LE) first entry(1), then up to
+ * TIMELINE_FRAME_ENTRIES x { stage(1) depth(1) start(4, LE) duration(4, LE) } */
+#define TIMELINE_FRAME_HEADER         3
+#define TIMELINE_FRAME_ENTRY          10
+#define TIMELINE_FRAME_ENTRIES        6
+
+/* --------------------------------
+ * Structure
+ * -------------------------------- */
+
+/* times in microseconds, start from the beginning of the cycle */
+struct timeline_entry {
+    uint8_t stage;
+    uint8_t depth;              // nesting, 0 for TIMELINE_TAP
+    uint16_t tap;               // tap number, wraps
+    uint32_t start;
+    uint32_t duration;
+};
+
+/* --------------------------------
+ * Class Declaration
+ * -------------------------------- */
+
+/*
+ * Collects the stages of one polling cycle with a microsecond clock and,
+ * when the cycle read a card, moves them to a ring that keeps whole taps
+ * for the host (oldest taps are dropped first). Cycles that found no card
+ * are discarded by the next begin(). Markers are TimelineScope objects,
+ * usually through TIMELINE_SCOPE(), so a stage closes on every return.
+ */
+class Timeline
+{
+public:
+    Timeline(uint32_t (*clock)(void));
+
+    void begin(void);                           // start of a polling cycle
+    void commit(void);                          // the cycle read a card
+
+    int open(int stage);                        // slot for close(), -1 when full
+    void close(int slot);
+
+    int entries(void) const;                    // entries in the ring
+    int read(int index, timeline_entry *entry) const;   // 0 is the oldest
+    uint32_t overflows(void) const;             // stages lost to a full cycle
+
+private:
+    void drop_tap(void);
+
+    uint32_t (*_clock)(void);
+    uint32_t _start;
+    uint16_t _tap;
+    int _depth;
+    int _used;
+    timeline_entry _current[(TIMELINE_ENTRIES > 0) ? TIMELINE_TAP_ENTRIES : 1];
+    timeline_entry _ring[(TIMELINE_ENTRIES > 0) ? TIMELINE_ENTRIES : 1];
+    int _head;
+    int _count;
+    uint32_t _overflows;
+};
+
+class TimelineScope
+{
+public:
+    TimelineScope(Timeline &timeline, int stage) : _timeline(timeline), _slot(timeline.open(stage)) {}
+    ~TimelineScope()
+    {
+        _timeline.close(_slot);
+    }
+
+private:
+    Timeline &_timeline;
+    int _slot;
+};
+
+#if TIMELINE_ENTRIES > 0
+#define TIMELINE_SCOPE(timeline, stage)   TimelineScope timeline_scope_(timeline, stage)
+#else
+#define TIMELINE_SCOPE(timeline, stage)
+#endif
+
+/* --------------------------------
+ * Function
+ * -------------------------------- */
+
+const char *timeline_stage_name(int stage);
+
+/* EVENT_TIMELINE payload for up to TIMELINE_FRAME_ENTRIES entries of one tap, returns its size */
+int timeline_pack(const timeline_entry *entries, int count, int first, uint8_t *payload);
+
+/* entries of an EVENT_TIMELINE payload (at most TIMELINE_FRAME_ENTRIES), -1 if malformed */
+int timeline_unpack(const uint8_t *payload, int len, int *first, timeline_entry *entries);
+
+#endif /* !TIMELINE_H_ */
@@ -0,0 +1,248 @@
+/* Buffered, non-blocking USB serial output
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "UsbOutput.h"
+
+/* --------------------------------
+ * Constant
+ * -------------------------------- */
+
+#define USB_PRINTF_SIZE               128
+#define USB_FLAG_DATA                 0x01
+#define USB_RETRY_INTERVAL            2ms         // packet in flight, host not reading or partial packet held
+#define USB_CONNECT_INTERVAL          100ms       // host not connected
+
+#if MBED_CONF_RTOS_PRESENT
+#define USB_LOCK()                    _mutex.lock()
+#define USB_UNLOCK()                  _mutex.unlock()
+#else
+#define USB_LOCK()
+#define USB_UNLOCK()
+#endif
+
+/* --------------------------------
+ * Function
+ * -------------------------------- */
+
+UsbOutput::UsbOutput(USBSerial &serial, int policy) :
+    _serial(serial),
+    _policy(policy),
+    _head(0),
+    _count(0),
+    _high_water(0),
+    _last_write(0),
+    _flush(false),
+    _sent(0),
+    _dropped(0),
+    _overflows(0)
+#if MBED_CONF_RTOS_PRESENT
+    , _thread(osPriorityBelowNormal, 1024, nullptr, "usb_output")
+#endif
+{
+}
+
+void UsbOutput::start(void)
+{
+#if MBED_CONF_RTOS_PRESENT
+    _thread.start(callback(this, &UsbOutput::run));
+#endif
+}
+
+ssize_t UsbOutput::write(const void *data, size_t len)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    size_t total = len;
+
+    USB_LOCK();
+    if (len > USB_BUFFER_SIZE - _count) {
+        _overflows++;
+        if (_policy == USB_DROP_NEWEST) {
+            _dropped += len;
+            USB_UNLOCK();
+            return 0;
+        }
+        if (len > USB_BUFFER_SIZE) {
+            // only the tail of the write fits at all
+            _dropped += len - USB_BUFFER_SIZE;
+            p += len - USB_BUFFER_SIZE;
+            len = USB_BUFFER_SIZE;
+        }
+        size_t excess = len - (USB_BUFFER_SIZE - _count);
+        _head = (_head + excess) % USB_BUFFER_SIZE;
+        _count -= excess;
+        _dropped += excess;
+    }
+
+    size_t tail = (_head + _count) % USB_BUFFER_SIZE;
+    size_t first = USB_BUFFER_SIZE - tail;
+    if (first > len) {
+        first = len;
+    }
+    memcpy(&_buffer[tail], p, first);
+    memcpy(&_buffer[0], p + first, len - first);
+    _count += len;
+    if (_count > _high_water) {
+        _high_water = _count;
+    }
+    _last_write = us_ticker_read();
+    USB_UNLOCK();
+
+#if MBED_CONF_RTOS_PRESENT
+    _flags.set(USB_FLAG_DATA);
+#else
+    poll();
+#endif
+    return total;
+}
+
+int UsbOutput::printf(const char *format, ...)
+{
+    char buf[USB_PRINTF_SIZE];
+    va_list args;
+    int len;
+
+    va_start(args, format);
+    len = vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    if (len < 0) {
+        return len;
+    }
+    if (len >= (int)sizeof(buf)) {
+        // the rest of the line is lost, reported like a full buffer
+        USB_LOCK();
+        _overflows++;
+        _dropped += len - (sizeof(buf) - 1);
+        USB_UNLOCK();
+        len = sizeof(buf) - 1;
+    }
+    write(buf, len);
+    return len;
+}
+
+void UsbOutput::flush(void)
+{
+    USB_LOCK();
+    _flush = (_count > 0);
+    USB_UNLOCK();
+
+#if MBED_CONF_RTOS_PRESENT
+    _flags.set(USB_FLAG_DATA);
+#else
+    poll();
+#endif
+}
+
+void UsbOutput::poll(void)
+{
+    uint8_t packet[USB_PACKET_SIZE];
+
+    USB_LOCK();
+    // send_nb() only copies into the endpoint buffer, so holding the lock is cheap
+    while ((_count > 0) && _serial.connected()) {
+        size_t len = peek(packet, sizeof(packet));
+        bool partial = (len < sizeof(packet));
+        if (partial && !_flush && !flushDue()) {
+            // wait for the rest of the packet
+            break;
+        }
+        uint32_t actual = 0;
+        if (!_serial.send_nb(packet, len, &actual, partial) || (actual == 0)) {
+            break;
+        }
+        consume(actual);
+        _sent += actual;
+    }
+    if (_count == 0) {
+        _flush = false;
+    }
+    USB_UNLOCK();
+}
+
+size_t UsbOutput::pending(void) const
+{
+    USB_LOCK();
+    size_t count = _count;
+    USB_UNLOCK();
+    return count;
+}
+
+size_t UsbOutput::highWater(void) const
+{
+    USB_LOCK();
+    size_t high_water = _high_water;
+    USB_UNLOCK();
+    return high_water;
+}
+
+uint32_t UsbOutput::sent(void) const
+{
+    USB_LOCK();
+    uint32_t sent = _sent;
+    USB_UNLOCK();
+    return sent;
+}
+
+uint32_t UsbOutput::dropped(void) const
+{
+    USB_LOCK();
+    uint32_t dropped = _dropped;
+    USB_UNLOCK();
+    return dropped;
+}
+
+uint32_t UsbOutput::overflows(void) const
+{
+    USB_LOCK();
+    uint32_t overflows = _overflows;
+    USB_UNLOCK();
+    return overflows;
+}
+
+/* ------------------------
+ * local
+ * ------------------------ */
+
+size_t UsbOutput::peek(uint8_t *data, size_t size)
+{
+    size_t len = (_count < size) ? _count : size;
+    size_t first = USB_BUFFER_SIZE - _head;
+
+    if (first > len) {
+        first = len;
+    }
+    memcpy(data, &_buffer[_head], first);
+    memcpy(data + first, &_buffer[0], len - first);
+    return len;
+}
+
+void UsbOutput::consume(size_t len)
+{
+    _head = (_head + len) % USB_BUFFER_SIZE;
+    _count -= len;
+}
+
+bool UsbOutput::flushDue(void) const
+{
+    return (uint32_t)(us_ticker_read() - _last_write) >= USB_FLUSH_TIMEOUT * 1000UL;
+}
+
+#if MBED_CONF_RTOS_PRESENT
+void UsbOutput::run(void)
+{
+    while (true) {
+        if (pending() == 0) {
+            _flags.wait_any(USB_FLAG_DATA);
+        }
+        else {
+            // wait for the packet in flight, or for the host to come back
+            _flags.wait_any_for(USB_FLAG_DATA, _serial.connected() ? USB_RETRY_INTERVAL : USB_CONNECT_INTERVAL);
+        }
+        poll();
+    }
+}
+#endif
@@ -0,0 +1,98 @@
+/* Buffered, non-blocking USB serial output
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef USB_OUTPUT_H_
+#define USB_OUTPUT_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "mbed.h"
+#include "USBSerial.h"
+
+/* --------------------------------
+ * Constant
+ * -------------------------------- */
+
+#ifndef USB_BUFFER_SIZE
+#define USB_BUFFER_SIZE               4096
+#endif
+
+/* usb-drop-policy (USB_DROP_POLICY) */
+#define USB_DROP_OLDEST               0           // overwrite the oldest pending bytes
+#define USB_DROP_NEWEST               1           // discard writes that do not fit
+
+#ifndef USB_DROP_POLICY
+#define USB_DROP_POLICY               USB_DROP_OLDEST
+#endif
+
+#ifndef USB_FLUSH_TIMEOUT
+#define USB_FLUSH_TIMEOUT             10          // ms without a write before a partial packet is sent
+#endif
+
+#define USB_PACKET_SIZE               64          // CDC bulk packet, full speed
+
+/* --------------------------------
+ * Class Declaration
+ * -------------------------------- */
+
+/*
+ * Ring buffer in front of USBSerial. write() only copies into RAM and
+ * never waits for the host; a background thread (or poll() on bare-metal)
+ * hands the pending bytes to USBCDC::send_nb() a full packet at a time,
+ * so many small writes leave as a few 64-byte packets. Less than a packet
+ * is held back until nothing was written for USB_FLUSH_TIMEOUT ms and
+ * then sent as a short packet, or at once after flush().
+ *
+ * When the host is slow or gone the buffer fills up and the policy
+ * decides what is lost. USB_DROP_NEWEST keeps every write whole;
+ * USB_DROP_OLDEST may cut the oldest pending line or frame, which the
+ * binary frame CRC detects on the host. printf() formats into a 128-byte
+ * buffer; the end of a longer line is counted in dropped() and
+ * overflows() like any other loss. The counters are read under the lock.
+ */
+class UsbOutput
+{
+public:
+    UsbOutput(USBSerial &serial, int policy = USB_DROP_POLICY);
+
+    void start(void);                           // starts the drain thread
+    ssize_t write(const void *data, size_t len);
+    int printf(const char *format, ...);
+    void flush(void);                           // sends a partial packet without waiting
+    void poll(void);                            // sends what USB accepts now
+
+    size_t pending(void) const;
+    size_t highWater(void) const;               // largest pending() seen
+    uint32_t sent(void) const;                  // bytes handed to USB
+    uint32_t dropped(void) const;               // bytes lost to the policy or cut by printf()
+    uint32_t overflows(void) const;             // writes that found the buffer full, printf() lines cut
+
+private:
+    size_t peek(uint8_t *data, size_t size);
+    void consume(size_t len);
+    bool flushDue(void) const;
+#if MBED_CONF_RTOS_PRESENT
+    void run(void);
+#endif
+
+    USBSerial &_serial;
+    int _policy;
+    uint8_t _buffer[USB_BUFFER_SIZE];
+    size_t _head;                               // next byte to send
+    size_t _count;
+    size_t _high_water;
+    uint32_t _last_write;                       // us_ticker_read() of the last write()
+    bool _flush;
+    uint32_t _sent;
+    uint32_t _dropped;
+    uint32_t _overflows;
+#if MBED_CONF_RTOS_PRESENT
+    mutable Mutex _mutex;
+    EventFlags _flags;
+    Thread _thread;
+#endif
+};
+
+#endif /* !USB_OUTPUT_H_ */
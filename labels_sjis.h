@@ -0,0 +1,65 @@
+/* Generated by printer-labels from Labels.h. Do not edit. */
+
+static const char *const labels_sjis[] = {
+    "\225s\226\276",    // LABEL_UNKNOWN
+    "\220\374 ",    // LABEL_LINE
+    "\211w",    // LABEL_STATION
+    "\216\355\225\312: ",    // LABEL_KIND
+    "\220V\213K",    // LABEL_NEW
+    "\216x\225\245\202\242",    // LABEL_PAYMENT
+    "\203`\203\203\201[\203W",    // LABEL_CHARGE
+    "\203I\201[\203g\203`\203\203\201[\203W",    // LABEL_AUTO_CHARGE
+    "\216c\215\202: ",    // LABEL_BALANCE
+    "\216c\215\202 ",    // LABEL_BALANCE_TOTAL
+    "\216c\212z: ",    // LABEL_REMAIN
+    "\227\230\227p\212z: ",    // LABEL_USED_AMOUNT
+    "\211~",    // LABEL_YEN
+    "\217\210\227\235\223\372\225t: ",    // LABEL_PROCESS_DATE
+    "\223\372\216\236: ",    // LABEL_DATE
+    "\224N",    // LABEL_YEAR
+    "\214\216",    // LABEL_MONTH
+    "\223\372",    // LABEL_DAY
+    "\227\230\227p\216\355\225\312: ",    // LABEL_USE_TYPE
+    "\216\251\223\256\211\374\216D\217o\217\352",    // LABEL_GATE_EXIT
+    "SF\203`\203\203\201[\203W\015",    // LABEL_SF_CHARGE
+    "\202\253\202\301\202\325\215w\223\374\015",    // LABEL_TICKET
+    "\216\245\213C\214\224\220\270\216Z",    // LABEL_MAGNETIC_FARE
+    "\217\346\211z\220\270\216Z",    // LABEL_EXCESS_FARE
+    "\221\213\214\373\220\270\216Z",    // LABEL_WINDOW_FARE
+    "\203`\203\203\201[\203W\215T\217\234",    // LABEL_CHARGE_DEDUCT
+    "\203o\203X/\230H\226\312\223\231\015",    // LABEL_BUS
+    "\216x\225\245\202\242\201i\220V\212\262\220\374\227\230\227p\201j\015",    // LABEL_SHINKANSEN
+    "\225\250\224\314",    // LABEL_SALE
+    "\214\273\213\340\225\271\227p\225\250\224\314",    // LABEL_CASH_SALE
+    "\223\374\217o\217\352\216\355\225\312: ",    // LABEL_GATE_TYPE
+    "\223\374\217\352\015",    // LABEL_ENTRY
+    "\217o\217\352\015",    // LABEL_EXIT
+    "\222\350\212\372\223\374\217\352\015",    // LABEL_PASS_ENTRY
+    "\222\350\212\372\217o\217\352\015",    // LABEL_PASS_EXIT
+    "\223\374\217\352\217\346\214p\015",    // LABEL_ENTRY_TRANSFER
+    "\221\213\214\373\217o\217\352",    // LABEL_WINDOW_EXIT
+    "\203o\203X\223\374\217o\217\352",    // LABEL_BUS_GATE
+    "\227\277\213\340\222\350\212\372",    // LABEL_FEE_PASS
+    "\217\346\214p\212\204\210\370\015",    // LABEL_TRANSFER_DISCOUNT
+    "\203o\203X\223\231\217\346\214p\212\204\210\370",    // LABEL_BUS_TRANSFER_DISCOUNT
+    "\214\224\226\312\212O\217\346\215~\015",    // LABEL_OFF_ROUTE
+    "nanaco\203|\203C\203\223\203g: ",    // LABEL_NANACO_POINT
+    "\210\370\214p",    // LABEL_TAKEOVER
+    "\203|\203C\203\223\203g\214\360\212\267\203`\203\203\201[\203W",    // LABEL_POINT_CHARGE
+    "\216\346\210\265\213\340\212z: ",    // LABEL_NANACO_AMOUNT
+    "\222[\226\226\224\324\215\206: ",    // LABEL_TERMINAL
+    "\225\324\225i",    // LABEL_RETURN
+    "\203`\203\203\201[\203W(\214\273\213\340\201A\203|\203C\203\223\203g\203`\203\203\201[\203W)",    // LABEL_CASH_CHARGE
+    "\203|\203C\203\223\203g\203_\203E\203\223\203\215\201[\203h",    // LABEL_POINT_DOWNLOAD
+    "\225\324\213\340",    // LABEL_REFUND
+    "\215w\223\374\216\236\202\311\203I\201[\203g\203`\203\203\201[\203W",    // LABEL_PURCHASE_AUTO_CHARGE
+    "\203I\201[\203g\203`\203\203\201[\203W(\213\342\215s)",    // LABEL_BANK_AUTO_CHARGE
+    "\220V\203J\201[\203h\202\326\202\314\210\332\215s",    // LABEL_CARD_MIGRATION
+    "\203|\203C\203\223\203g\214\360\212\267(\227a\223\374)",    // LABEL_POINT_EXCHANGE
+    "\203`\203\203\201[\203W\212z: ",    // LABEL_CHARGE_AMOUNT
+    " \203|\203C\203\223\203g\216c\215\202 ",    // LABEL_POINT_BALANCE
+    "\224\255\215s\223\372: ",    // LABEL_ISSUE_DATE
+    "\203o\203\212\203\205\201[\203`\203\203\201[\203W",    // LABEL_VALUE_CHARGE
+    "\227\230\227p\223\372\216\236: ",    // LABEL_USE_DATE
+    "\217\210\227\235\223\340\227e: ",    // LABEL_PROCESS
+};
@@ -3,23 +3,52 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
-#include <time.h>
-
 #include "mbed.h"
 #include "USBSerial.h"
 #include "SB1602E.h"
 #include "RCS620S.h"
 #include "AS289R2.h"
 #include "AS289R2_stub.h"
-#include "sc_utf8.h"
+#include "StationDB.h"
+#include "StationDBFile.h"
+#include "ReceiptLine.h"
+#include "History.h"
+#include "HistoryRender.h"
+#include "DateTime.h"
+#include "EventFrame.h"
+#include "UsbOutput.h"
+#include "PollScheduler.h"
+#include "CardClassifier.h"
+#include "ProbeOrder.h"
+#include "Timeline.h"
+#include "LcdOutput.h"
+#include "PrintSpooler.h"
+#include "Passthrough.h"
+#include "IdmScanner.h"
+#include "IdmSet.h"
+#include "StationData.h"     // 内蔵の駅データ (StationData.S)
+#if PRINTER_SJIS && !defined(PRINTER_DB_FILE)
+// 内蔵の駅データはUTF-8の1つだけ（Shift_JISの駅データと両方はフラッシュに入らない）
+#error "printer-sjis needs printer-db-file, the Shift_JIS station data is read from LittleFS"
+#endif
+#if defined(STATION_DB_FILE) || defined(PROBE_STATS_FILE) || defined(PRINTER_DB_FILE)
+#define USE_FILE_SYSTEM
+#include "LittleFileSystem.h"
+#include <sys/stat.h>
+#endif
+#ifdef STATION_DB_ADDRESS
+#include "blockdevice/SlicingBlockDevice.h"
+#endif
 
 // RCS620S
 #define PUSH_TIMEOUT                  2100
 #define COMMAND_TIMEOUT               400
-#define POLLING_INTERVAL              500ms
+#define STATION_DB_CHECK_INTERVAL     1000        // 更新ファイルの確認間隔 (ms)
+#define SCAN_REPORT_INTERVAL          10000       // スキャンモードの集計の出力間隔 (ms)
 #define RCS620S_MAX_CARD_BUFFER_LEN   30
  
 // FeliCa Service/System Code
+#define WILDCARD_SYSTEM_CODE          0xFFFF
 #define CYBERNE_SYSTEM_CODE           0x0300
 #define SAPICA_SYSTEM_CODE            0x5E86
 #define COMMON_SYSTEM_CODE            0x00FE
@@ -62,23 +91,52 @@
 
 #define SWAP(type,a,b)          { type work = a; a = b; b = work; }
 
+int poll_system(uint16_t system_code, uint16_t *polled);
 int requestService(uint16_t serviceCode);
+int probe_cyberne(uint16_t system_code);
 int readEncryption(uint16_t serviceCode, uint8_t blockNumber, uint8_t *buf);
 void printBalanceLCD(const char *card_name, uint32_t balance);
-void parse_history_suica(uint8_t *buf);
-void parse_history_nanaco(uint8_t *buf);
-void parse_history_waon(uint8_t *buf);
-void parse_history_edy(uint8_t *buf);
-void parse_history_ecomyca(uint8_t *buf);
-int get_station_name(char *buf, int area, int line, int station);
-void get_bus_name(char *buf, int code);
-
-const uint32_t record_length = (3 + 40 + 40);
+int parse_history_waon(uint8_t *buf);
+void mount_file_system(void);
+void load_probe_stats(void);
+void save_probe_stats(void);
+void load_station_db(void);
+void update_station_db(void);
+void add_id(ReceiptLine *out, const char *name, const uint8_t *id);
+void add_dump(ReceiptLine *out, const uint8_t *buf, int len);
+void dump_block(const uint8_t *buf, int len);
+void send_frame(uint8_t type, const uint8_t *payload, int len);
+void send_card(int card, const char *name, const uint8_t *id, uint32_t balance);
+void send_record(const history_record *rec, const uint8_t *raw, int len);
+void send_end(int count);
+void report_usb_drops(void);
+void check_usb_command(void);
+void report_print_jobs(void);
+void export_timeline(void);
+void report_station_cache(void);
+void run_passthrough(void);
+void run_scan(void);
+void send_scan(const uint8_t *id, uint32_t now);
+void report_scan(uint32_t now);
 
 DigitalOut led(LED1);
 USBSerial serial(false);
+UsbOutput usb_out(serial);           // USBシリアルへの出力はリングバッファ経由（待たない）
+Timeline timeline(us_ticker_read);  // 読み取り1回分の処理時間の内訳（USBから't'で出力）
 SB1602E lcd(I2C_LCD_SDA, I2C_LCD_SCL);
+LcdOutput lcd_out(lcd);             // LCDには変わった文字だけを別スレッドで書き込む
 RCS620S rcs620s(RCS620S_TX, RCS620S_RX);
+#if PASSTHROUGH_QUEUE > 0
+Passthrough passthrough(serial, rcs620s, usb_out);  // USBからホストがリーダーを操作する（'p'で開始）
+#endif
+StationDBSlot station_db;
+#if PRINTER_SJIS
+StationDB printer_db;               // 印字用（Shift_JIS）の駅データ（printer-db-file）
+#endif
+#ifdef USE_FILE_SYSTEM
+LittleFileSystem flash_fs("fs");
+int fs_mounted = 0;
+#endif
 
 #if USE_AS289R2_PRINTER
 AS289R2 tp(AS289R2_TX, AS289R2_RX);
@@ -86,6 +144,129 @@ AS289R2 tp(AS289R2_TX, AS289R2_RX);
 AS289R2_STUB tp(AS289R2_TX, AS289R2_RX);
 #endif
 
+// プリンタ（スプーラーのスレッドから印刷する）
+template <class T>
+class PrinterDevice : public PrintDevice
+{
+public:
+    PrinterDevice(T &printer, PinName busy) : _printer(printer), _busy(busy) {}
+    virtual void write(const uint8_t *data, size_t len)
+    {
+        _printer.write(data, len);
+    }
+    virtual void lineFeed(int lines)
+    {
+        _printer.putLineFeed(lines);
+    }
+    virtual void doubleWidth(int on)
+    {
+        if (on) {
+            _printer.setDoubleSizeWidth();
+        }
+        else {
+            _printer.clearDoubleSizeWidth();
+        }
+    }
+    virtual int busy(void)
+    {
+        return _busy.is_connected() && _busy.read();
+    }
+
+private:
+    T &_printer;
+    DigitalIn _busy;
+};
+
+PrinterDevice<decltype(tp)> printer(tp, PRINTER_BUSY);
+PrintSpooler spooler(printer);      // 1回の読み取り分をまとめて裏で印刷する
+
+// 履歴の出力先（1回整形した行をUSBシリアルとプリンタに書き出す）
+template <class T>
+class StreamSink : public ReceiptSink
+{
+public:
+    StreamSink(T &stream, int copy, const char *newline, int stage) : ReceiptSink(copy, newline), _stream(stream), _stage(stage) {}
+    virtual void output(const char *data, size_t len)
+    {
+        TIMELINE_SCOPE(timeline, _stage);
+        _stream.write(data, len);
+    }
+
+protected:
+    T &_stream;
+    int _stage;
+};
+
+// プリンタには倍幅の指定も送る
+class PrinterSink : public StreamSink<PrintSpooler>
+{
+public:
+    PrinterSink(PrintSpooler &spooler) : StreamSink<PrintSpooler>(spooler, RECEIPT_PRINT, "\r", TIMELINE_PRINTER) {}
+    virtual void doubleWidth(bool on)
+    {
+        if (on) {
+            _stream.setDoubleSizeWidth();
+        }
+        else {
+            _stream.clearDoubleSizeWidth();
+        }
+    }
+    virtual void lineFeed(int lines)
+    {
+        _stream.putLineFeed(lines);
+    }
+};
+
+#if USB_OUTPUT == USB_OUTPUT_TEXT
+StreamSink<UsbOutput> serial_sink(usb_out, RECEIPT_TEXT, "\n", TIMELINE_USB);
+#else
+// バイナリ出力ではUSBシリアルに文字を出力しない（send_frame）
+class NullSink : public ReceiptSink
+{
+public:
+    NullSink() : ReceiptSink(RECEIPT_TEXT, "") {}
+    virtual void output(const char *data, size_t len) {}
+};
+
+NullSink serial_sink;
+#endif
+PrinterSink printer_sink(spooler);
+ReceiptOutput receipt;
+HistoryRender render(receipt, serial_sink, printer_sink, station_db, timeline);    // 履歴を行に整形する（駅名の検索を含む）
+PollScheduler poll_scheduler;       // ポーリング間隔（カードが続く間は短く、空いたら長く）
+Timer poll_timer;
+CardClassifier classifier;          // IDm/PMmからカード種別を予測（サービスの問い合わせを減らす）
+IdmSet recent_cards;                // 最近読み取ったカード（card-ttlの間は読み飛ばす）
+#if IDM_SCAN
+IdmScanner scanner;                 // スキャンモードで同じカードを続けて出力しない
+#endif
+
+// 交通系ICカードの種別判定（サービスコードを上から順に問い合わせる）
+struct card_probe {
+    const char *name;
+    uint16_t service_code;
+    uint16_t unless;            // 先に判定するサービスコード（これにも応答すれば別の種別、0はなし）
+};
+
+const card_probe cyberne_probes[] = {
+    { "Kitaca",  KITACA_SERVICE_CODE,      0 },
+    { "toica",   TOICA_SERVICE_CODE,       0 },
+    { "SUGOCA",  SUGOCA_SERVICE_CODE,      0 },
+    { "PiTaPa",  PITAPA_SERVICE_CODE,      0 },
+    { "PASMO",   PASMO_SERVICE_CODE,       0 },
+    { "SAPICA",  SAPICA_SERVICE_CODE,      0 },
+    { "manaca",  MANACA_SERVICE_CODE,      0 },
+    { "nimoca",  NIMOCA_SERVICE_CODE,      0 },
+    { "Suica+",  SUICA_PLUS_SERVICE_CODE,  0 },
+    { "Suica",   SUICA_SERVICE_CODE,       SUICA_PLUS_SERVICE_CODE },
+    { "Hayaka",  HAYAKAKEN_SERVICE_CODE,   0 },
+    { "W-Suica", WSUICA_SERVICE_CODE,      0 },
+};
+#define CYBERNE_PROBE_COUNT           (int)(sizeof(cyberne_probes) / sizeof(cyberne_probes[0]))
+ProbeOrder probe_order(CYBERNE_PROBE_COUNT);    // よく使われる種別から問い合わせる
+
+history_record records[PRINT_ENTRIES];  // 復号した履歴（駅名は表示時に検索）
+
 int main()
 {
     uint8_t buffer[20][16];
@@ -94,15 +275,18 @@ int main()
 
     DigitalIn boot_mode(BOOT_PIN, PullUp);
 
-    lcd.setCharsInLine(8);
+    lcd.setCharsInLine(LCD_COLUMNS);
     lcd.clear();
     lcd.contrast(0x35);
+    lcd_out.start();
 
     ThisThread::sleep_for(2000ms);
 
     if (boot_mode.read() == 0) {
-        lcd.printf(0, 0, (char*)"Waiting");
-        lcd.printf(0, 1, (char*)"USB...");
+        lcd_out.begin();
+        lcd_out.printf(0, 0, "Waiting");
+        lcd_out.printf(0, 1, "USB...");
+        lcd_out.end();
         serial.init();
         serial.connect();
         while(serial.connected() == false) {
@@ -110,25 +294,61 @@ int main()
         }
     }
 
-    lcd.printf(0, 0, (char*)"FeliCa  ");
-    lcd.printf(0, 1, (char*)"Reader  ");
+    usb_out.start();
+#if PASSTHROUGH_QUEUE > 0
+    passthrough.start();
+#endif
 
-    serial.printf("\n*** RCS620S FeliCaリーダープログラム ***\n\n");
+    lcd_out.begin();
+    lcd_out.clear();
+    lcd_out.printf(0, 0, "FeliCa");
+    lcd_out.printf(0, 1, "Reader");
+    lcd_out.end();
 
+#if USB_OUTPUT == USB_OUTPUT_TEXT
+    usb_out.printf("\n*** RCS620S FeliCaリーダープログラム ***\n\n");
+#endif
+
+    mount_file_system();
+    load_station_db();
+    load_probe_stats();
     rcs620s.initDevice();
     tp.initialize();
     tp.putLineFeed(1);
+    spooler.start();
+    receipt.attach(&serial_sink);
+    receipt.attach(&printer_sink);
     memset(idm, 0, 8);
+    for (int i = 0; i < CYBERNE_PROBE_COUNT; i++) {
+        // SAPICAのシステムコードで応答したカードはSAPICA
+        if (cyberne_probes[i].service_code == SAPICA_SERVICE_CODE) {
+            classifier.addRule(SAPICA_SYSTEM_CODE, i);
+        }
+    }
+    poll_timer.start();
+#if IDM_SCAN
+    run_scan();
+#endif
+    uint32_t db_checked = 0;
 
     while (1) {
         uint32_t balance = 0;
         uint8_t buf[RCS620S_MAX_CARD_BUFFER_LEN];
+        uint8_t polled_idm[8];
+        uint16_t system_code = 0;
         int isCaptured = 0;
+
+        timeline.begin();
         
         rcs620s.timeout = COMMAND_TIMEOUT;
+
+        // ワイルドカードのポーリング1回で、カードがないときや最近読み取ったカードは読み飛ばす
+        uint32_t polled = std::chrono::duration_cast<std::chrono::milliseconds>(poll_timer.elapsed_time()).count();
+        int fresh = poll_system(WILDCARD_SYSTEM_CODE, &system_code) && !recent_cards.seen(rcs620s.idm, polled);
+        memcpy(polled_idm, rcs620s.idm, 8);
         
         // サイバネ領域
-        if (rcs620s.polling(CYBERNE_SYSTEM_CODE) || rcs620s.polling(SAPICA_SYSTEM_CODE)) {
+        if (fresh && (poll_system(CYBERNE_SYSTEM_CODE, &system_code) || poll_system(SAPICA_SYSTEM_CODE, &system_code))) {
             // Suica, PASMO等の交通系ICカード
             if (requestService(PASSNET_SERVICE_CODE)) {
                 for (int i = 0; i < 20; i++) {
@@ -136,18 +356,12 @@ int main()
                         memcpy(buffer[i], &buf[12], 16);
                     }
                 }
-                if (memcmp(idm, buf + 1, 8) != 0) {
-                    // カード変更
-                    isCaptured = 1;
-                    memcpy(idm, buf + 1, 8);
-                    char info[40];
-                    snprintf(info, sizeof(info), "IDm: %02x%02x-%02x%02x-%02x%02x-%02x%02x", idm[0], idm[1], idm[2], idm[3], idm[4], idm[5], idm[6], idm[7]);
-                    serial.printf("%s\n", info);
-                }
-                else {
-                    // 前と同じカード
-                    isCaptured = 0;
-                }
+                isCaptured = 1;
+                memcpy(idm, buf + 1, 8);
+                ReceiptLine line;
+                add_id(&line, "IDm: ", idm);
+                line.newline();
+                serial_sink.write(line);
             }
             if (isCaptured) {
                 if (requestService(FELICA_ATTRIBUTE_CODE)) {
@@ -164,96 +378,48 @@ int main()
                     strcpy(card, "ICOCA");
                 }
                 else {
-                    if (requestService(KITACA_SERVICE_CODE)) {
-                        strcpy(card, "Kitaca");
-                    }
-                    else if (requestService(TOICA_SERVICE_CODE)) {
-                        strcpy(card, "toica");
-                    }
-                    else if (requestService(SUGOCA_SERVICE_CODE)) {
-                        strcpy(card, "SUGOCA");
-                    }
-                    else if (requestService(PITAPA_SERVICE_CODE)) {
-                        strcpy(card, "PiTaPa");
-                    }
-                    else if (requestService(PASMO_SERVICE_CODE)) {
-                        strcpy(card, "PASMO");
-                    }
-                    else if (requestService(SAPICA_SERVICE_CODE)) {
-                        strcpy(card, "SAPICA");
-                    }
-                    else if (requestService(MANACA_SERVICE_CODE)) {
-                        strcpy(card, "manaca");
-                    }
-                    else if (requestService(NIMOCA_SERVICE_CODE)) {
-                        strcpy(card, "nimoca");
-                    }
-                    else if (requestService(SUICA_PLUS_SERVICE_CODE)) {
-                        strcpy(card, "Suica+");
-                    }
-                    else if (requestService(SUICA_SERVICE_CODE)) {
-                        strcpy(card, "Suica");
-                    }                    
-                    else if (requestService(HAYAKAKEN_SERVICE_CODE)) {
-                        strcpy(card, "Hayaka");
-                    }                    
-                    else if (requestService(WSUICA_SERVICE_CODE)) {
-                        strcpy(card, "W-Suica");
-                    }                    
-                    else {
-                        strcpy(card, "Suica-IO");
-                    }
+                    int family = probe_cyberne(system_code);
+                    strcpy(card, (family == CARD_FAMILY_UNKNOWN) ? "Suica-IO" : cyberne_probes[family].name);
                 }
 
                 // 残高表示
                 printBalanceLCD(card , balance);
+                send_card(HISTORY_CYBERNE, card, idm, balance);
 
                 // 履歴表示
+                int count = history_decode_batch(HISTORY_CYBERNE, buffer, PRINT_ENTRIES, records);
                 for (int i = (PRINT_ENTRIES - 1); i >= 0; i--) {
-                    if (buffer[i][0] != 0) {
-                        parse_history_suica(&buffer[i][0]);
+                    if (records[i].flags & HISTORY_VALID) {
+                        dump_block(buffer[i], 16);
+                        render.cyberne(&records[i]);
+                        send_record(&records[i], buffer[i], 16);
                     }
                 }
-                tp.putLineFeed(4);
-                isCaptured = 0;
+                send_end(count);
+                printer_sink.lineFeed(4);
             }
         }
         
         // 共通領域
-        else if (rcs620s.polling(COMMON_SYSTEM_CODE)){
+        else if (fresh && poll_system(COMMON_SYSTEM_CODE, &system_code)){
             // Edy
             if (requestService(EDY_ATTRIBUTE_CODE) && readEncryption(EDY_ATTRIBUTE_CODE, 0, buf)) {                    
-                if (memcmp(idm, &buf[12 + 2], 8) != 0) {
-                    isCaptured = 1;
-                    memcpy(idm, &buf[12 + 2], 8);
-                }
-                else {
-                    isCaptured = 0;
-                }
+                isCaptured = 1;
+                memcpy(idm, &buf[12 + 2], 8);
                 if (requestService(EDY_ATTRIBUTE_CODE) && readEncryption(EDY_ATTRIBUTE_CODE, 0, buf) && isCaptured) {                    
-                    char info[80];
-                    snprintf(info, sizeof(info), "Edy ID: %02x%02x-%02x%02x-%02x%02x-%02x%02x", buf[12+2], buf[12+3], buf[12+4], buf[12+5], buf[12+6], buf[12+7], buf[12+8], buf[12+9]);
-                    serial.printf("%s\n", info);
-                    tp.printf("%s\r", info);
+                    ReceiptLine line;
+                    add_id(&line, "Edy ID: ", &buf[12 + 2]);
+                    line.newline();
+                    receipt.write(line);
                     
-                    int tmp;
-                    tmp = buf[12 + 10];
-                    int day = ((tmp << 8) + buf[12+11]) >> 1;
-                    int sec = ((buf[12 + 11] & 1) << 16) + (buf[12 + 12] << 8) + buf[12 + 13];
-
-                    struct tm tm, *pt;
-                    time_t t = (time_t)(-1);
-                    tm.tm_year = 2000 - 1900;
-                    tm.tm_mon = 1 - 1;
-                    tm.tm_mday = 1 + day;
-                    tm.tm_hour = 0;
-                    tm.tm_min = 0;
-                    tm.tm_sec = sec;
-                    t = mktime(&tm);
-                    pt = localtime(&t);
-                    snprintf(info, sizeof(info), "発行日: %d年%d月%d日 %02d:%02d", pt->tm_year+1900, pt->tm_mon+1, pt->tm_mday, pt->tm_hour, pt->tm_min);
-                    serial.printf("%s\n", info);
-                    tp.printf("%s\r", info);
+                    date_time issued = decode_date_time_edy(&buf[12 + 10]);
+                    line.clear();
+                    line.format(LABEL_ISSUE_DATE);
+                    line.date(issued.year, issued.month, issued.day);
+                    line.add(' ');
+                    line.time(issued.hour, issued.minute);
+                    line.newline();
+                    receipt.write(line);
                 }
                 if (requestService(EDY_SERVICE_CODE) && readEncryption(EDY_SERVICE_CODE, 0, buf) && isCaptured) {
                     balance = buf[12 + 0];
@@ -268,48 +434,62 @@ int main()
                             memcpy(buffer[i], &buf[12], 16);
                         }
                     }
+                    send_card(HISTORY_EDY, "Edy", idm, balance);
+                    int count = history_decode_batch(HISTORY_EDY, buffer, 6, records);
                     for (int i = 5; i >= 0; i--) {
-                        if (isCaptured) {
-                            parse_history_edy(&buffer[i][0]);
+                        if (records[i].flags & HISTORY_VALID) {
+                            render.edy(&records[i]);
+                            send_record(&records[i], buffer[i], 16);
                         }
                     }
-                    tp.setDoubleSizeWidth();
-                    tp.printf("\r残高 %ld円\r\r", balance);
-                    tp.clearDoubleSizeWidth();
-                    tp.putLineFeed(3);
+                    send_end(count);
+                    ReceiptLine line;
+                    line.newline();
+                    printer_sink.doubleWidth(true);
+                    printer_sink.write(line);
+                    line.clear();
+                    line.format(LABEL_BALANCE_TOTAL);
+                    line.yen((long)balance);
+                    line.newline();
+                    line.newline();
+                    printer_sink.write(line);
+                    printer_sink.doubleWidth(false);
+                    printer_sink.lineFeed(3);
                 }
             }
             
             // nanaco
             if (requestService(NANACO_ID_CODE) && readEncryption(NANACO_ID_CODE, 0, buf)) {
-                if (memcmp(idm, &buf[12], 8) != 0) {
-                    uint32_t point;
-                    char info[40];
-                    memcpy(idm, &buf[12], 8);
-                    snprintf(info, sizeof(info), "nanaco ID: %02x%02x-%02x%02x-%02x%02x-%02x%02x", buf[12], buf[13], buf[14], buf[15], buf[16], buf[17], buf[18], buf[19]);
-                    serial.printf("%s\n", info);
-                    tp.printf("%s\r", info);
-                    readEncryption(NANACO_POINT_CODE, 1, buf);
-                    point = buf[12 + 1];
-                    point = (point << 8) + buf[12 + 2];
-                    snprintf(info, sizeof(info), "nanacoポイント: %ldpt", point);
-                    serial.printf("%s\n\n", info);
-                    tp.printf("%s\r\r", info);
-                    isCaptured = 1;
-                }
-                else {
-                    isCaptured = 0;
-                }
+                uint32_t point;
+                ReceiptLine line;
+                memcpy(idm, &buf[12], 8);
+                add_id(&line, "nanaco ID: ", &buf[12]);
+                line.newline();
+                receipt.write(line);
+                readEncryption(NANACO_POINT_CODE, 1, buf);
+                point = buf[12 + 1];
+                point = (point << 8) + buf[12 + 2];
+                line.clear();
+                line.format(LABEL_NANACO_POINT);
+                line.dec((long)point);
+                line.add("pt");
+                line.newline();
+                line.newline();
+                receipt.write(line);
+                isCaptured = 1;
             }
 #if 0
             if (requestService(NANACO_POINT_CODE) && readEncryption(NANACO_POINT_CODE, 1, buf) && isCaptured) {
                 uint32_t point;
-                char info[40];
+                ReceiptLine line;
                 point = buf[12 + 1];
                 point = (point << 8) + buf[12 + 2];
-                snprintf(info, sizeof(info), "nanacoポイント: %ldpt", point);
-                serial.printf("%s\n\n", info);
-                tp.printf("%s\r\r", info);
+                line.format(LABEL_NANACO_POINT);
+                line.dec((long)point);
+                line.add("pt");
+                line.newline();
+                line.newline();
+                receipt.write(line);
             }
 #endif
             if (requestService(NANACO_BALANCE_CODE) && readEncryption(NANACO_BALANCE_CODE, 0, buf) && isCaptured) {
@@ -320,32 +500,42 @@ int main()
                 balance += (buf[12 + 3] << 8);
                 // 残高表示
                 printBalanceLCD("nanaco", balance);
+                send_card(HISTORY_NANACO, "nanaco", idm, balance);
                 
+                int count = 0;
                 for (int i = 5; i > 0; i--) {
-                    if (readEncryption(NANACO_SERVICE_CODE, i-1, buf)) {
-                        parse_history_nanaco(buf);
+                    if (readEncryption(NANACO_SERVICE_CODE, i-1, buf) && history_decode_nanaco(&buf[12], &records[0])) {
+                        dump_block(buf, RCS620S_MAX_CARD_BUFFER_LEN-2);
+                        render.nanaco(&records[0]);
+                        send_record(&records[0], &buf[12], 16);
+                        count++;
                     }
                 }
-                tp.printf("\r");
-                tp.setDoubleSizeWidth();
-                tp.printf("\r残高 %ld円\r\r", balance);
-                tp.clearDoubleSizeWidth();
-                tp.putLineFeed(3);
+                send_end(count);
+                ReceiptLine line;
+                line.newline();
+                printer_sink.write(line);
+                printer_sink.doubleWidth(true);
+                printer_sink.write(line);
+                line.clear();
+                line.format(LABEL_BALANCE_TOTAL);
+                line.yen((long)balance);
+                line.newline();
+                line.newline();
+                printer_sink.write(line);
+                printer_sink.doubleWidth(false);
+                printer_sink.lineFeed(3);
             }
             
             // waon
             if (requestService(WAON_SERVICE_ID) && readEncryption(WAON_SERVICE_ID, 0, buf)) {
-                if (memcmp(idm, &buf[12], 8) != 0) {
-                    char info[40];
-                    isCaptured = 1;
-                    memcpy(idm, &buf[12], 8);
-                    snprintf(info, sizeof(info), "WAON ID: %02x%02x-%02x%02x-%02x%02x-%02x%02x", buf[12], buf[13], buf[14], buf[15], buf[16], buf[17], buf[18], buf[19]);
-                    serial.printf("%s\n\n", info);
-                    tp.printf("%s\r\r", info);
-                }
-                else {
-                    isCaptured = 0;
-                }
+                ReceiptLine line;
+                isCaptured = 1;
+                memcpy(idm, &buf[12], 8);
+                add_id(&line, "WAON ID: ", &buf[12]);
+                line.newline();
+                line.newline();
+                receipt.write(line);
             }
             if (requestService(WAON_SERVICE_CODE1) && readEncryption(WAON_SERVICE_CODE1, 0, buf) && isCaptured) {
                 // Little Endianで入っているwaonの残高を取り出す
@@ -353,41 +543,55 @@ int main()
                 balance = (balance << 8) + buf[12];
                 // 残高表示
                 printBalanceLCD("waon", balance);
+                send_card(HISTORY_WAON, "WAON", idm, balance);
 
-                parse_history_waon(buf);
+                send_end(parse_history_waon(buf));
 
-                serial.printf("残高 %ld円\n", balance);
-                tp.setDoubleSizeWidth();
-                tp.printf("残高 %ld円\r\r", balance);
-                tp.clearDoubleSizeWidth();
-                tp.putLineFeed(3);
+                ReceiptLine line;
+                line.format(LABEL_BALANCE_TOTAL);
+                line.yen((long)balance);
+                line.newline();
+                serial_sink.write(line);
+                line.newline();
+                printer_sink.doubleWidth(true);
+                printer_sink.write(line);
+                printer_sink.doubleWidth(false);
+                printer_sink.lineFeed(3);
 
             }
         }
-        if (rcs620s.polling(ECOMYCA_SYSTEM_CODE)) {
-            char info[80];
+        if (fresh && poll_system(ECOMYCA_SYSTEM_CODE, &system_code)) {
             if (requestService(ECOMYCA_SERVICE_CODE0) && readEncryption(ECOMYCA_SERVICE_CODE0, 1, buf)) {
-                if (memcmp(idm, &buf[12 + 8], 8) != 0) {
-                    memcpy(idm, &buf[12 + 8], 8);
-                    isCaptured = 1;
-                }
-                else {
-                    isCaptured = 0;
-                }
-                if (isCaptured) {
-                    serial.printf("\n");
-                    for (int i = 0; i < 16; i++) {
-                        serial.printf("%02X ", buf[12 + i]);
+                memcpy(idm, &buf[12 + 8], 8);
+                isCaptured = 1;
+                ReceiptLine line;
+                line.newline();
+                serial_sink.write(line);
+                line.clear();
+                add_dump(&line, &buf[12], 16);
+                line.newline();
+                serial_sink.write(line);
+
+                line.clear();
+                date_time issued = decode_date_cjrc(&buf[12 + 0]);
+                line.add("カード発行日: ");
+                line.dec(issued.year);
+                line.add('/');
+                line.dec(issued.month, 2, '0');
+                line.add('/');
+                line.dec(issued.day, 2, '0');
+                line.newline();
+                serial_sink.write(line);
+                line.clear();
+                line.add("IDm: ");
+                for (int i = 4; i < 8; i++) {
+                    line.hex(idm[i]);
+                    if (i == 5) {
+                        line.add('-');
                     }
-                    serial.printf("\n");
-
-                    snprintf(info, sizeof(info), "カード発行日: %d/%02d/%02d", 2000+(buf[12 + 0]>>1), ((buf[12 + 0]&1)<<3 | ((buf[12 + 1]&0xe0)>>5)), buf[12 + 1]&0x1f);
-                    serial.printf("%s\r", info);
-                    snprintf(info, sizeof(info), "IDm: %02x%02x-%02x%02x", idm[4], idm[5], idm[6], idm[7]);
-                    serial.printf("%s\n", info);
-
                 }
-                
+                line.newline();
+                serial_sink.write(line);
             }
 
             if (requestService(ECOMYCA_SERVICE_CODE1) && readEncryption(ECOMYCA_SERVICE_CODE1, 0, buf) && isCaptured) {
@@ -395,6 +599,9 @@ int main()
                 balance += (buf[12 + 0] << 8);
                 printBalanceLCD("ecomyca", balance);
             }
+            if (isCaptured) {
+                send_card(HISTORY_ECOMYCA, "ecomyca", idm, balance);
+            }
             if (isCaptured) {
                 for (int i = 0; i < 20; i++) {
                     if (readEncryption(ECOMYCA_SERVICE_CODE2, i, buf)) {
@@ -402,375 +609,52 @@ int main()
                     }
                 }
                 // 履歴表示
+                int count = history_decode_batch(HISTORY_ECOMYCA, buffer, PRINT_ENTRIES, records);
                 for (int i = (PRINT_ENTRIES - 1); i >= 0; i--) {
-                    if (buffer[i][0] != 0) {
-                        parse_history_ecomyca(&buffer[i][0]);
+                    if (records[i].flags & HISTORY_VALID) {
+                        dump_block(buffer[i], 16);
+                        render.ecomyca(&records[i]);
+                        send_record(&records[i], buffer[i], 16);
                     }
                 }
+                send_end(count);
             }
         }
-        rcs620s.rfOff();
-        led = !led;
-        ThisThread::sleep_for(POLLING_INTERVAL);
-    }
-}
-
-void parse_history_suica(uint8_t *buf)
-{
-    char info[80+80+4], info2[40+40];
-    int region_in, region_out, line_in, line_out, station_in, station_out;
-
-    region_in = (buf[0xf] >> 6) & 3;
-    region_out = (buf[0xf] >> 4) & 3;
-    line_in = buf[6];
-    station_in = buf[7];
-    line_out = buf[8];
-    station_out = buf[9];
-
-    serial.printf("\n");
-    for (int i = 0; i < 16; i++) {
-        serial.printf("%02X ", buf[i]);
-    }
-    serial.printf("\n");
-
-    snprintf(info, sizeof(info), "機種種別: ");
-    switch (buf[0]) {
-        case 0x03:
-            strcat(info, "のりこし精算機\r");
-            break;
-        case 0x04:
-            strcat(info, "携帯型端末\r");
-            break;
-        case 0x05:
-            strcat(info, "バス/路面等\r");
-            break;
-        case 0x09:
-            strcat(info, "入金機\r");
-            break;
-        case 0x07:
-        case 0x08:
-        case 0x12:
-            strcat(info, "券売機\r");
-            break;
-        case 0x14:
-        case 0x15:
-            strcat(info, "券売機等\r");
-            break;
-        case 0x16:
-            strcat(info, "自動改札機\r");
-            break;
-        case 0x17:
-            strcat(info, "簡易改札機\r");
-            break;
-        case 0x18:
-        case 0x19:
-            strcat(info, "窓口端末\r");
-            break;
-        case 0x1A:
-            strcat(info, "改札端末\r");
-            break;
-        case 0x1B:
-            strcat(info, "モバイルFeliCa\r");
-            break;
-        case 0x1C:
-            strcat(info, "乗継精算機\r");
-            break;
-        case 0x1D:
-            strcat(info, "連絡改札機\r");
-            break;
-        case 0x1F:
-            strcat(info, "簡易入金機\r");
-            break;
-        case 0x22:
-            strcat(info, "窓口処理機\r");
-            break;
-        case 0x23:
-            strcat(info, "乗継精算機\r");
-            break;
-        case 0x46:
-        case 0x48:
-            strcat(info, "ビューアルッテ端末\r");
-            break;
-        case 0xc7:
-        case 0xc9:
-            strcat(info, "物販端末\r");
-            break;
-        case 0xc8:
-            strcat(info, "自販機\r");
-            break;
-        default:
-            strcat(info, "不明\r");
-            break;
-    }
-    serial.printf("%s", info);
-    //tp.printf("%s", info);
-
-    int hasStationName = 0;
-    snprintf(info, sizeof(info), "利用種別: ");
-    switch (buf[1]) {
-        case 0x01:
-            strcat(info, "自動改札出場");
-            break;
-        case 0x02:
-            strcat(info, "SFチャージ\r");
-            hasStationName = 1;
-            break;
-        case 0x03:
-            strcat(info, "きっぷ購入\r");
-            hasStationName = 1;
-            break;
-        case 0x04:
-            strcat(info, "磁気券精算");
-            break;
-        case 0x05:
-            strcat(info, "乗越精算");
-            break;
-        case 0x06:
-            strcat(info, "窓口精算");
-            break;
-        case 0x07:
-            strcat(info, "新規");
-            if (line_in == 0 && station_in == 0) {
-                hasStationName = 0;
-            }
-            else {
-                strcat(info, "\r");
-                hasStationName = 1;
-            }
-            break;
-        case 0x08:
-            strcat(info, "チャージ控除");
-            break;
-        case 0x0C:
-        case 0x0D:
-        case 0x0F:
-            strcat(info, "バス/路面等\r");
-            get_bus_name(info, ((line_in << 8) | station_in));
-            break;
-        case 0x13:
-            strcat(info, "支払い（新幹線利用）\r");
-            hasStationName = 2;
-            break;
-        case 0x14:
-        case 0x15:
-            strcat(info, "オートチャージ");
-            break;
-        case 0x46:
-            strcat(info, "物販");
-            break;
-        case 0xc6:
-            strcat(info, "現金併用物販");
-            break;
-        default:
-            strcat(info, "不明");
-            break;
-    }
-    if (hasStationName >= 1) {
-        if (get_station_name(info2, region_in, line_in, station_in) != 0) {
-            get_bus_name(info2, ((line_in << 8) | station_in));
-        }
-        strcat(info, info2);
-    }
-    if (hasStationName == 2) {
-        strcat(info, " - ");
-        get_station_name(info2, region_out, line_out, station_out);
-        strcat(info, info2);
-    }
-    serial.printf("%s\r", info);
-    tp.printf("%s\r", info);
-
-#if 0
-    if (buf[2] != 0) {
-        snprintf(info, sizeof(info), "支払種別: ");
-        switch (buf[2]) {
-            case 0x02:
-                strcat(info, "VIEW\r");
-                break;
-            case 0x0B:
-                strcat(info, "PiTaPa\r");
-                break;
-            case 0x0d:
-                strcat(info, "オートチャージ対応PASMO\r");
-                break;
-            case 0x3f:
-                strcat(info, "モバイルSuica\r");
-                break;
-            default:
-                strcat(info, "不明\r");
-                break;
-        }
-        serial.printf("%s", info);
-        tp.printf("%s", info);
-    }
-#endif
-
-    hasStationName = 0;
-    if (buf[1] == 0x01 || buf[1] == 0x14) {
-        snprintf(info, sizeof(info), "入出場種別: ");
-        switch (buf[3]) {
-            case 0x01:
-            case 0x08:
-                strcat(info, "入場\r");
-                hasStationName = 1;
-                break;
-            case 0x02:
-                strcat(info, "出場\r");
-                hasStationName = 2;
-                break;
-            case 0x03:
-                strcat(info, "定期入場\r");
-                hasStationName = 1;
-                break;
-            case 0x04:
-                strcat(info, "定期出場\r");
-                hasStationName = 2;
-                break;
-            case 0x05:
-                strcat(info, "入場乗継\r");
-                hasStationName = 2;
-                break;
-            case 0x0E:
-                strcat(info, "窓口出場");
-                break;
-            case 0x0F:
-                strcat(info, "バス入出場");
-                break;
-            case 0x12:
-                strcat(info, "料金定期");
-                break;
-            case 0x17:
-            case 0x1D:
-                strcat(info, "乗継割引\r");
-                hasStationName = 2;
-                break;
-            case 0x21:
-                strcat(info, "バス等乗継割引");
-                break;
-            case 0x22:
-            case 0x25:
-            case 0x26:
-                strcat(info, "券面外乗降\r");
-                hasStationName = 2;
-                break;
-            default:
-                strcat(info, "不明");
-                snprintf(info2, sizeof(info2), " %02X %02X %02X %02X", buf[6], buf[7], buf[8], buf[9]);
-                strcat(info, info2);
-                break;
+        {
+            TIMELINE_SCOPE(timeline, TIMELINE_POLL);
+            rcs620s.rfOff();
         }
-        if (hasStationName >= 1) {
-            get_station_name(info2, region_in, line_in, station_in);
-            strcat(info, info2);
+        spooler.submit();
+
+        uint32_t now = std::chrono::duration_cast<std::chrono::milliseconds>(poll_timer.elapsed_time()).count();
+        if (isCaptured) {
+            // 読み取れたカードだけを入れる（途中で離したカードはすぐに読み直す）
+            recent_cards.insert(polled_idm, now);
+            poll_scheduler.activity(now);
+            timeline.commit();
         }
-        if (hasStationName == 2) {
-            strcat(info, " - ");
-            get_station_name(info2, region_out, line_out, station_out);
-            strcat(info, info2);
+        if ((now - db_checked) >= STATION_DB_CHECK_INTERVAL) {
+            update_station_db();
+            save_probe_stats();
+            db_checked = now;
         }
-        serial.printf("%s\r", info);
-        tp.printf("%s\r", info);
-    }
-
-    snprintf(info, sizeof(info), "処理日付: %d/%02d/%02d", 2000+(buf[4]>>1), ((buf[4]&1)<<3 | ((buf[5]&0xe0)>>5)), buf[5]&0x1f);
-    if (buf[1] == 0x46 || buf[1] == 0xc6) {   // 物販
-        snprintf(info2, sizeof(info2), " %02d:%02d:%02d", (buf[6] & 0xF8) >> 3, ((buf[6] & 0x7) << 3) | ((buf[7] & 0xe0) >> 5), (buf[7] & 0x1f));
-        strcat(info, info2);
-    }
-    strcat(info, "\r");
-    serial.printf("%s", info);
-    tp.printf("%s", info);
-
-    snprintf(info, sizeof(info), "残額: %d円", (buf[11]<<8) + buf[10]); 
-    serial.printf("%s\n", info);
-    tp.setDoubleSizeWidth();
-    tp.printf("%s\r\r", info);
-    tp.clearDoubleSizeWidth();
-}
-
-void parse_history_nanaco(uint8_t *buf)
-{
-    char info[80], info2[10];
-    uint16_t tmp;
-
-    if (buf[12] == 0) {
-        return;
-    }
-
-    serial.printf("\n");
-    for (int i = 0; i < RCS620S_MAX_CARD_BUFFER_LEN-2; i++) {
-        serial.printf("%02X ", buf[i]);
-    }
-    serial.printf("\n");
-    snprintf(info, sizeof(info), "種別: ");
-    if (buf[12] == 0x35) {
-        strcat(info, "引継");
-    }
-    if (buf[12] == 0x47) {
-        strcat(info, "支払い");
-    }
-    if (buf[12] == 0x6F || buf[12] == 0x70) {
-        strcat(info, "チャージ");
-    }
-    if (buf[12] == 0x77) {
-        strcat(info, "オートチャージ");
-    }
-    if (buf[12] == 0x7A) {
-        strcat(info, "新規");
-    }
-    if (buf[12] == 0x83) {
-        strcat(info, "ポイント交換チャージ");
+        report_usb_drops();
+        report_print_jobs();
+        check_usb_command();
+        led = !led;
+        ThisThread::sleep_for(std::chrono::milliseconds(poll_scheduler.next(now)));
     }
-    serial.printf("%s\n", info);
-    tp.printf("%s\r", info);
-    
-    tmp = buf[21];
-    tmp = (tmp << 8) + buf[22];
-    tmp = (tmp >> 5) & 0x07FF;
-    snprintf(info, sizeof(info), "日時: %d年", 2000+tmp);
-    
-    tmp = buf[22] & 0x1E;
-    tmp = (tmp >> 1);
-    snprintf(info2, sizeof(info2), "%02d月", tmp);
-    strcat(info, info2);
-
-    tmp = buf[22];
-    tmp = (tmp << 8) + buf[23];
-    tmp = (tmp >> 4) & 0x001F;
-    snprintf(info2, sizeof(info2), "%02d日 ", tmp);
-    strcat(info, info2);
-
-    tmp = buf[23];
-    tmp = (tmp << 8) + buf[24];
-    tmp = (tmp >> 6) & 0x3F;
-    snprintf(info2, sizeof(info2), "%02d:", tmp);
-    strcat(info, info2);
-
-    tmp = buf[24];
-    tmp = tmp & 0x3F;
-    snprintf(info2, sizeof(info2), "%02d", tmp);
-    strcat(info, info2);
-    serial.printf("%s\r", info);
-    tp.printf("%s\r", info);
-
-    tmp = buf[15];
-    tmp = (tmp << 8) + buf[16];
-    snprintf(info, sizeof(info), "取扱金額: %d円", tmp);
-    serial.printf("%s\r", info);
-    tp.printf("%s\r", info);
-
-    tmp = buf[19];
-    tmp = (tmp << 8) + buf[20];
-    snprintf(info, sizeof(info), "残高: %d円", tmp);
-    serial.printf("%s\r", info);
-    tp.printf("%s\r", info);
 }
 
-void parse_history_waon(uint8_t *buf)
+int parse_history_waon(uint8_t *buf)
 {
-    char info[200], info2[50];
+    TIMELINE_SCOPE(timeline, TIMELINE_FORMAT);
+    history_record rec;
+    uint8_t raw[32];                // 端末番号と通番、取引内容の2ブロック
+    uint8_t *head = &raw[0];
+    int count = 0;
     uint32_t num[3] = {0};
     int array[3] = {0, 2, 4};
-    uint32_t tmp;
     
     for (int i = 0; i < 3; i += 2) {
         if (readEncryption(WAON_SERVICE_CODE0, i*2, buf)) {
@@ -787,259 +671,90 @@ void parse_history_waon(uint8_t *buf)
         }
     }
 
-    int next_valid = 0;
     for (int i = 0; i < 3; i++) {
+        // 端末番号と通番のブロックに続いて取引内容のブロック
         if (readEncryption(WAON_SERVICE_CODE0, array[i], buf)) {
-            tmp = buf[12 + 13];
-            tmp = (tmp << 8) + buf[12 + 14];
-            if (tmp != 0) {
-                serial.printf("------\n");
-                snprintf(info, sizeof(info), "端末番号: ");
-                for (int ch = 0; ch <= 12; ch++) {
-                    snprintf(info2, sizeof(info2), "%c", buf[12 + ch]);
-                    strcat(info, info2);
-                }
-                snprintf(info2, sizeof(info2), " (%ld)\r", tmp);
-                strcat(info, info2);
-                serial.printf("%s", info);
-                tp.printf("%s", info);
-                next_valid = 1;
-            }
-            else {
-                next_valid = 0;
+            memcpy(head, &buf[12], 16);
+            if (readEncryption(WAON_SERVICE_CODE0, array[i] + 1, buf) &&
+                history_decode_waon(head, &buf[12], &rec)) {
+                memcpy(&raw[16], &buf[12], 16);
+                render.waon(&rec, head);
+                send_record(&rec, raw, 32);
+                count++;
             }
         }
-        if (next_valid && readEncryption(WAON_SERVICE_CODE0, array[i] + 1, buf)) {
-            snprintf(info, sizeof(info), "種別: ");
-            tmp = buf[12 + 1];
-            switch (tmp) {
-                case 0x04:
-                    snprintf(info2, sizeof(info2), "支払い");
-                    break;
-                case 0x08:
-                    snprintf(info2, sizeof(info2), "返品");
-                    break;
-                case 0x0C:
-                    snprintf(info2, sizeof(info2), "チャージ(現金、ポイントチャージ)");
-                    break;
-                case 0x10:
-                    snprintf(info2, sizeof(info2), "チャージ");
-                    break;
-                case 0x18:
-                    snprintf(info2, sizeof(info2), "ポイントダウンロード");
-                    break;
-                case 0x28:
-                    snprintf(info2, sizeof(info2), "返金");
-                    break;
-                case 0x1C:
-                case 0x20:
-                    snprintf(info2, sizeof(info2), "購入時にオートチャージ");
-                    break;
-                case 0x30:
-                    snprintf(info2, sizeof(info2), "オートチャージ(銀行)");
-                    break;
-                case 0x3C:
-                    snprintf(info2, sizeof(info2), "新カードへの移行");
-                    break;
-                case 0x7C:
-                    snprintf(info2, sizeof(info2), "ポイント交換(預入)");
-                    break;
-            }
-            strcat(info, info2);
-            serial.printf("%s\n", info);
-            tp.printf("%s\r", info);
-
-            tmp = buf[12 + 2];
-            tmp = ((tmp >> 3) & 0x1F) + 2005;
-            snprintf(info, sizeof(info), "日時: %ld年", tmp);
-
-            tmp = buf[12 + 2];
-            tmp = ((tmp & 0x7) << 1) + ((buf[12 + 3] >> 7 ) & 0x01);
-            snprintf(info2, sizeof(info2), "%2ld月", tmp);
-            strcat(info, info2);
-
-            tmp = ((buf[12 + 3] >> 2) & 0x1F);
-            snprintf(info2, sizeof(info2), "%2ld日 ", tmp);
-            strcat(info, info2);
-
-            tmp = ((buf[12 + 3] << 3 ) & 0x18);
-            tmp = tmp + ((buf[12 + 4] >> 5) & 0x7);
-            snprintf(info2, sizeof(info2), "%02ld:", tmp);
-            strcat(info, info2);
-
-            tmp = (buf[12 + 4] & 0x1F);
-            tmp = (tmp << 1) + ((buf[12 + 5] >> 7) & 0x01);
-            snprintf(info2, sizeof(info2), "%02ld\r", tmp);
-            strcat(info, info2);
-            serial.printf("%s", info);
-            tp.printf("%s", info);
-
-            tmp = buf[12 + 7] & 0x1F;
-            tmp = (tmp << 8) + buf[12 + 8];
-            tmp = (tmp << 5) + ((buf[12 + 9] & 0xF8) >> 3);
-            if (tmp != 0) {
-                snprintf(info, sizeof(info), "利用額: %ld円", tmp);
-                serial.printf("%s\n", info);
-                tp.printf("%s\r", info);
-            }
-
-            tmp = buf[12 + 9] & 0x07;
-            tmp = (tmp << 8) + buf[12 + 10];
-            tmp = (tmp << 6) + ((buf[12 + 11] & 0xFC) >> 2);
-            if (tmp != 0) {
-                snprintf(info, sizeof(info), "チャージ額: %ld円", tmp);
-                serial.printf("%s\n", info);
-                tp.printf("%s\r", info);
-            }
-
-            tmp = (buf[12 + 5] & 0x7F);
-            tmp = (tmp << 8) + buf[12 + 6];
-            tmp = (tmp << 3) + ((buf[12 + 7] & 0xE0) >> 5);
-            snprintf(info, sizeof(info), "残高: %ld円", tmp);
-            serial.printf("%s\n", info);
-            tp.printf("%s\r\r", info);
-
-        }
     }
     if (requestService(WAON_SERVICE_CODE2) && readEncryption(WAON_SERVICE_CODE2, 0, buf)) {
+        uint32_t tmp;
+        ReceiptLine line;
         tmp = buf[12 + 0];
         tmp = (tmp << 8) + buf[12 + 1];
         tmp = (tmp << 8) + buf[12 + 2];
-        snprintf(info, sizeof(info), "\r20%x年%x月%x日 ポイント残高 %ldpt\r", buf[12 + 11], buf[12 + 12], buf[12 + 13], tmp);
-        serial.printf("%s", info);
-        tp.printf("%s", info);
+        line.add("\r20");
+        line.hex(buf[12 + 11], 1);
+        line.format(LABEL_YEAR);
+        line.hex(buf[12 + 12], 1);
+        line.format(LABEL_MONTH);
+        line.hex(buf[12 + 13], 1);
+        line.format(LABEL_DAY);
+        line.format(LABEL_POINT_BALANCE);
+        line.dec((long)tmp);
+        line.add("pt\r");
+        receipt.write(line);
     }
+    return count;
 }
 
-void parse_history_edy(uint8_t *buf)
+// ポーリングに応答したシステムコードを覚えておく
+int poll_system(uint16_t system_code, uint16_t *polled)
 {
-    char info[100], info2[30];
-    uint32_t tmp;
-
-    tmp = buf[4];
-    int day = (((tmp << 8) + buf[5]) >> 1);
-    if (day == 0) {
-        return;
-    }
-    int sec = ((buf[5]&1) << 16) + (buf[6] << 8) + buf[7];
-
-    struct tm tm, *pt;
-    time_t t = (time_t)(-1);
-    tm.tm_year = 2000 - 1900;
-    tm.tm_mon = 1 - 1;
-    tm.tm_mday = 1 + day;
-    tm.tm_hour = 0;
-    tm.tm_min = 0;
-    tm.tm_sec = sec;
-    t = mktime(&tm);
-    pt = localtime(&t);
-    
-    snprintf(info, sizeof(info), "-----\n");
-    serial.printf("%s", info);
-    tp.printf("\r");
-
-    snprintf(info, sizeof(info), "種別: ");
-    switch(buf[0]) {
-        case 0x02:
-            snprintf(info2, sizeof(info2), "チャージ ");
-            break;
-        case 0x04:
-            snprintf(info2, sizeof(info2), "バリューチャージ ");
-            break;
-        case 0x20:
-            snprintf(info2, sizeof(info2), "支払い ");
-            break;
-        default:
-            snprintf(info2, sizeof(info2), "不明(%d) ", buf[12]);
-            break;
+    TIMELINE_SCOPE(timeline, TIMELINE_POLL);
+    if (!rcs620s.polling(system_code)) {
+        return 0;
     }
-    strcat(info, info2);
-    serial.printf("%s\n", info);
-    tp.printf("%s\r", info);
-    
-    snprintf(info, sizeof(info), "利用日時: %d年%d月%d日 %02d:%02d", pt->tm_year+1900, pt->tm_mon+1, pt->tm_mday, pt->tm_hour, pt->tm_min);
-    serial.printf("%s\n", info);
-    tp.printf("%s\r", info);
-
-    tmp = buf[8];
-    tmp = (tmp << 8) + buf[9];
-    tmp = (tmp << 8) + buf[10];
-    tmp = (tmp << 8) + buf[11];
-    snprintf(info, sizeof(info), "利用額: %ld円", tmp);
-    serial.printf("%s\n", info);
-    tp.printf("%s\r", info);
-    
-    tmp = buf[12];
-    tmp = (tmp << 8) + buf[13];
-    tmp = (tmp << 8) + buf[14];
-    tmp = (tmp << 8) + buf[15];
-    snprintf(info, sizeof(info), "残高: %ld円", tmp);
-    serial.printf("%s\n", info);
-    tp.printf("%s\r\r", info);
+    *polled = system_code;
+    return 1;
 }
 
-void parse_history_ecomyca(uint8_t *buf)
+// 交通系ICカードの種別（cyberne_probesの番号、どれにも該当しなければCARD_FAMILY_UNKNOWN）
+// 予測できれば1回の問い合わせで確認し、外れたときや確信がないときはよく使われる種別から問い合わせる
+int probe_cyberne(uint16_t system_code)
 {
-    char info[80+80+4], info2[40+40];
+    card_signature sig = card_signature_of(system_code, rcs620s.idm, rcs620s.pmm);
+    int predicted = classifier.predict(sig);
+    int family = CARD_FAMILY_UNKNOWN;
 
-    serial.printf("\n");
-    for (int i = 0; i < 16; i++) {
-        serial.printf("%02X ", buf[i]);
-    }
-    serial.printf("\n");
-
-    snprintf(info, sizeof(info), "機種種別: ");
-    switch (buf[9] & 0xF0) {
-        case 0x20:
-            strcat(info, "鉄道\r");
-            break;
-        case 0x70:
-            strcat(info, "窓口精算機\r");
-            break;
-        case 0x90:
-            strcat(info, "運賃箱カードリーダー\r");
-            break;
-        default:
-            strcat(info, "不明\r");
-            break;
+    if ((predicted != CARD_FAMILY_UNKNOWN) && requestService(cyberne_probes[predicted].service_code) &&
+        ((cyberne_probes[predicted].unless == 0) || !requestService(cyberne_probes[predicted].unless))) {
+        family = predicted;
     }
-    serial.printf("%s", info);
-
-    snprintf(info, sizeof(info), "処理内容: ");
-    switch (buf[9] & 0x0F) {
-        case 0x00:
-            strcat(info, "新規");
-            break;
-        case 0x02:
-            strcat(info, "支払い");
-            break;
-        default:
-            strcat(info, "不明");
+    else {
+        for (int rank = 0; rank < CYBERNE_PROBE_COUNT; rank++) {
+            int i = probe_order.at(rank);
+            if ((i == predicted) || !requestService(cyberne_probes[i].service_code)) {
+                continue;
+            }
+            // unlessの種別はまだ問い合わせていなければ確かめる（順番が後でも見つかる）
+            uint16_t unless = cyberne_probes[i].unless;
+            for (int r = 0; (unless != 0) && (r < rank); r++) {
+                if (cyberne_probes[probe_order.at(r)].service_code == unless) {
+                    unless = 0;
+                }
+            }
+            if ((unless != 0) && requestService(unless)) {
+                continue;
+            }
+            family = i;
             break;
+        }
     }
-    serial.printf("%s\r", info);
-    tp.printf("%s\r", info);
-
-    snprintf(info, sizeof(info), "処理日付: %d/%02d/%02d", 2000+(buf[0]>>1), ((buf[0]&1)<<3 | ((buf[1]&0xe0)>>5)), buf[1]&0x1f);
-    snprintf(info2, sizeof(info2), " %02d:%02d", ((buf[2] & 0xfc) >> 2), ((buf[2] & 0x03) << 4) | (buf[3] & 0xf0) >> 4);
-    strcat(info, info2);
-    snprintf(info2, sizeof(info2), " %02d:%02d", (buf[3] & 0x0f) << 2 | ((buf[4] & 0xc0) >> 6), (buf[4] & 0x3f));
-    strcat(info, info2);
-
-    strcat(info, "\r");
-    serial.printf("%s", info);
-    tp.printf("%s", info);
-
-    snprintf(info, sizeof(info), "利用金額: %d円", (buf[0xa]<<8) + buf[0xb]); 
-    serial.printf("%s\n", info);
-    snprintf(info, sizeof(info), "残額: %d円", (buf[0xe]<<8) + buf[0xf]); 
-    serial.printf("%s\n", info);
-    tp.setDoubleSizeWidth();
-    tp.printf("%s\r\r", info);
-    tp.clearDoubleSizeWidth();
+    classifier.learn(sig, predicted, family);
+    probe_order.record(family);
+    return family;
 }
 
 int requestService(uint16_t serviceCode){
+    TIMELINE_SCOPE(timeline, TIMELINE_PROBE);
     int ret;
     uint8_t buf[RCS620S_MAX_CARD_BUFFER_LEN];
     uint8_t responseLen = 0;
@@ -1061,6 +776,7 @@ int requestService(uint16_t serviceCode){
 }
 
 int readEncryption(uint16_t serviceCode, uint8_t blockNumber, uint8_t *buf){
+    TIMELINE_SCOPE(timeline, TIMELINE_READ);
     int ret;
     uint8_t responseLen = 0;
     
@@ -1085,59 +801,474 @@ int readEncryption(uint16_t serviceCode, uint8_t blockNumber, uint8_t *buf){
 
 void printBalanceLCD(const char *card_name, uint32_t balance)
 {
-    lcd.clear();
-    lcd.printf(0, 0, (char*)"%s", card_name);
-    lcd.printf(0, 1, (char*)"\\ %d", balance);
+    TIMELINE_SCOPE(timeline, TIMELINE_LCD);
+    lcd_out.begin();
+    lcd_out.clear();
+    lcd_out.printf(0, 0, "%s", card_name);
+    lcd_out.printf(0, 1, "\\ %lu", (unsigned long)balance);
+    lcd_out.end();
+}
+
+void mount_file_system(void)
+{
+#ifdef USE_FILE_SYSTEM
+    BlockDevice *bd = BlockDevice::get_default_instance();
+#ifdef STATION_DB_ADDRESS
+    // 駅データはstation-db-addressから後ろに書き込んであるので、LittleFSはその手前だけを使う
+    static SlicingBlockDevice fs_bd(bd, 0, STATION_DB_ADDRESS);
+    if (bd != NULL) {
+        bd = &fs_bd;
+    }
+#endif
+    fs_mounted = (bd != NULL) && (flash_fs.mount(bd) == 0);
+#endif
+}
+
+// カード種別ごとの判定回数（再起動後も問い合わせの順番を引き継ぐ）
+void load_probe_stats(void)
+{
+#ifdef PROBE_STATS_FILE
+    if (fs_mounted) {
+        probe_order.load(PROBE_STATS_FILE);
+    }
+#endif
+}
+
+void save_probe_stats(void)
+{
+#ifdef PROBE_STATS_FILE
+    if (fs_mounted && probe_order.dirty()) {
+        probe_order.save(PROBE_STATS_FILE);
+    }
+#endif
+}
+
+void load_station_db(void)
+{
+#if PRINTER_SJIS
+    if (fs_mounted) {
+        // 駅名はファイルから読み続けるので、開けたreaderは解放しない（開けなければ「不明」と印字）
+        FileStationDBReader *reader = new FileStationDBReader(PRINTER_DB_FILE);
+        if (printer_db.open(reader)) {
+            render.setPrinterDB(&printer_db);
+        }
+        else {
+            delete reader;
+        }
+    }
+#endif
+#ifdef STATION_DB_FILE
+    if (fs_mounted) {
+        // 前回の動作中に切り替えた駅データ、まだ切り替えていない更新ファイルの順に置き換える
+        // （.aと.bが両方あるのは切り替え直後の電源断で、どちらも検証済みなので.bを使う）
+        rename(STATION_DB_FILE ".a", STATION_DB_FILE);
+        rename(STATION_DB_FILE ".b", STATION_DB_FILE);
+        StationDB db;
+        FileStationDBReader reader(STATION_DB_FILE ".new");
+        if (db.open(&reader)) {
+            db.close();
+            rename(STATION_DB_FILE ".new", STATION_DB_FILE);
+        }
+        if (station_db.load(new FileStationDBReader(STATION_DB_FILE))) {
+            return;
+        }
+    }
+#endif
+#ifdef STATION_DB_ADDRESS
+    // ブロックデバイスに直接書き込んだ駅データ（station-db-address）
+    BlockDevice *bd = BlockDevice::get_default_instance();
+    if ((bd != NULL) && (bd->init() == 0)) {
+        if (station_db.load(new BlockDeviceStationDBReader(bd, STATION_DB_ADDRESS))) {
+            return;
+        }
+    }
+#endif
+    // 内蔵の駅データ
+    station_db.load(sc_compact, sc_compact_len);
+}
+
+void update_station_db(void)
+{
+#ifdef STATION_DB_FILE
+    // 更新ファイルがあれば別名に移してから検証して切り替える（ファイルの置き換えは次回起動時）
+    // 使用中の駅データは開いたまま読み続けるので、次の更新ファイルで上書きされないように.aと.bを交互に使う
+    static const char *const paths[2] = { STATION_DB_FILE ".a", STATION_DB_FILE ".b" };
+    static int active = -1;     // 起動時の駅データは STATION_DB_FILE
+    static uint32_t rejected_crc = 0;
+    station_db_header header;
+    struct stat st;
+    if (!fs_mounted || (stat(STATION_DB_FILE ".new", &st) != 0)) {
+        return;     // ほとんどの場合はファイルがないので、開かずに済ませる
+    }
+    {
+        FileStationDBReader reader(STATION_DB_FILE ".new");
+        if (!reader.read(0, &header, sizeof(header)) || (header.crc == rejected_crc)) {
+            return;
+        }
+    }
+    StationDB *db = station_db.lock();
+    uint32_t active_crc = db->crc();
+    station_db.unlock();
+    if (header.crc == active_crc) {
+        return;
+    }
+    int next = (active == 0) ? 1 : 0;
+    remove(paths[next]);
+    if (rename(STATION_DB_FILE ".new", paths[next]) != 0) {
+        return;
+    }
+    // CRCは移した後のファイル全体で確認する（load()）ので、切り替えるのは検証したものと同じ内容
+    if (station_db.load(new FileStationDBReader(paths[next]))) {
+        if (active >= 0) {
+            remove(paths[active]);  // 切り替え前の駅データはload()の中で閉じている
+        }
+        active = next;
+#if USB_OUTPUT == USB_OUTPUT_TEXT
+        usb_out.printf("駅データ更新: %08lx\n", header.crc);
+#endif
+    }
+    else {
+        // 書き込み途中などで正しくなければ元の名前に戻し、同じ内容では再検証しない
+        rename(paths[next], STATION_DB_FILE ".new");
+        rejected_crc = header.crc;
+    }
+#endif
 }
 
-int get_station_name(char *buf, int area, int line, int station) {
-    unsigned int offset = 0;
-    int ret = 0;
+void add_id(ReceiptLine *out, const char *name, const uint8_t *id) {
+    // "xxxx-xxxx-xxxx-xxxx"
+    out->add(name);
+    for (int i = 0; i < 8; i++) {
+        out->hex(id[i]);
+        if ((i & 1) && (i < 7)) {
+            out->add('-');
+        }
+    }
+}
+
+void add_dump(ReceiptLine *out, const uint8_t *buf, int len) {
+    for (int i = 0; i < len; i++) {
+        out->hex(buf[i], 2, true);
+        out->add(' ');
+    }
+}
+
+void dump_block(const uint8_t *buf, int len) {
+    // 受信データ（USBシリアルのみ）
+    ReceiptLine line;
+    line.newline();
+    serial_sink.write(line);
+    line.clear();
+    add_dump(&line, buf, len);
+    line.newline();
+    serial_sink.write(line);
+}
+
+void send_frame(uint8_t type, const uint8_t *payload, int len) {
+    TIMELINE_SCOPE(timeline, TIMELINE_USB);
+#if USB_OUTPUT != USB_OUTPUT_TEXT
+    uint8_t frame[EVENT_FRAME_PAYLOAD_MAX + EVENT_FRAME_OVERHEAD];
+    int n = event_frame_encode(type, payload, len, frame, sizeof(frame));
+    if (n > 0) {
+        usb_out.write(frame, n);
+    }
+#else
+    (void)type;
+    (void)payload;
+    (void)len;
+#endif
+}
+
+void send_card(int card, const char *name, const uint8_t *id, uint32_t balance) {
+    uint8_t payload[EVENT_FRAME_PAYLOAD_MAX];
+    int len = strlen(name);
+    if (len > EVENT_FRAME_PAYLOAD_MAX - EVENT_CARD_SIZE) {
+        len = EVENT_FRAME_PAYLOAD_MAX - EVENT_CARD_SIZE;
+    }
+    payload[0] = card;
+    memcpy(&payload[1], id, 8);
+    payload[9] = balance & 0xFF;
+    payload[10] = (balance >> 8) & 0xFF;
+    payload[11] = (balance >> 16) & 0xFF;
+    payload[12] = (balance >> 24) & 0xFF;
+    memcpy(&payload[EVENT_CARD_SIZE], name, len);
+    send_frame(EVENT_CARD, payload, EVENT_CARD_SIZE + len);
+}
+
+void send_record(const history_record *rec, const uint8_t *raw, int len) {
+#if USB_OUTPUT == USB_OUTPUT_BINARY_RAW
+    // 生のブロック（WAONは2ブロック）
+    uint8_t payload[1 + 32];
+    if (len > 32) {
+        len = 32;
+    }
+    payload[0] = rec->card;
+    memcpy(&payload[1], raw, len);
+    send_frame(EVENT_RAW, payload, 1 + len);
+#elif USB_OUTPUT == USB_OUTPUT_BINARY
+    uint8_t payload[HISTORY_PACKED_SIZE];
+    (void)raw;
+    (void)len;
+    send_frame(EVENT_RECORD, payload, history_pack(rec, payload, sizeof(payload)));
+#else
+    (void)rec;
+    (void)raw;
+    (void)len;
+#endif
+}
+
+void send_end(int count) {
+    uint8_t payload[1] = { (uint8_t)count };
+    send_frame(EVENT_END, payload, 1);
+}
+
+// ホストが読み出せずに破棄したUSB出力があれば知らせる（bare-metalではここで送信も進める）
+void report_usb_drops(void) {
+    static uint32_t reported = 0;
+    uint32_t dropped = usb_out.dropped();
+
+#if !MBED_CONF_RTOS_PRESENT
+    usb_out.poll();
+#endif
+    if (dropped == reported) {
+        return;
+    }
+    reported = dropped;
+#if USB_OUTPUT == USB_OUTPUT_TEXT
+    usb_out.printf("USB出力: %lu バイト破棄 (オーバーフロー %lu 回)\n", (unsigned long)dropped, (unsigned long)usb_out.overflows());
+#else
+    uint32_t overflows = usb_out.overflows();
+    uint8_t payload[EVENT_DROPPED_SIZE];
+    for (int i = 0; i < 4; i++) {
+        payload[i] = (uint8_t)(dropped >> (i * 8));
+        payload[4 + i] = (uint8_t)(overflows >> (i * 8));
+    }
+    send_frame(EVENT_DROPPED, payload, sizeof(payload));
+#endif
+}
+
+// ホストから't'を受け取ったら記録した読み取りの処理時間を出力し、'p'ならパススルーモードに入る
+void check_usb_command(void) {
+    while (serial.readable()) {
+        switch (serial.getc()) {
+            case 't':
+                export_timeline();
+                break;
+#if PASSTHROUGH_QUEUE > 0
+            case 'p':
+                run_passthrough();
+                break;
+#endif
+            default:
+                break;
+        }
+    }
+}
+
+// ホストがリーダーを直接操作する（カードのポーリングは止める）
+void run_passthrough(void) {
+#if PASSTHROUGH_QUEUE > 0
+    lcd_out.begin();
+    lcd_out.clear();
+    lcd_out.printf(0, 0, "Host");
+    lcd_out.printf(0, 1, "Control");
+    lcd_out.end();
+
+    rcs620s.timeout = COMMAND_TIMEOUT;
+    uint32_t served = passthrough.run();
+    rcs620s.rfOff();
+
+    lcd_out.begin();
+    lcd_out.clear();
+    lcd_out.printf(0, 0, "FeliCa");
+    lcd_out.printf(0, 1, "Reader");
+    lcd_out.end();
+#if USB_OUTPUT == USB_OUTPUT_TEXT
+    usb_out.printf("パススルー終了: %lu 件\n", (unsigned long)served);
+#else
+    (void)served;
+#endif
+#endif
+}
+
+void export_timeline(void) {
+#if (TIMELINE_ENTRIES > 0) && (USB_OUTPUT == USB_OUTPUT_TEXT)
+    for (int i = 0; i < timeline.entries(); i++) {
+        timeline_entry e;
+        timeline.read(i, &e);
+        if (e.stage == TIMELINE_TAP) {
+            usb_out.printf("timeline tap=%u %luus\n", e.tap, (unsigned long)e.duration);
+        }
+        else {
+            usb_out.printf("%*s%s +%lu %luus\n", e.depth * 2, "", timeline_stage_name(e.stage),
+                           (unsigned long)e.start, (unsigned long)e.duration);
+        }
+    }
+    if (timeline.overflows() != 0) {
+        usb_out.printf("timeline overflows=%lu\n", (unsigned long)timeline.overflows());
+    }
+#elif TIMELINE_ENTRIES > 0
+    // 1フレームには同じ読み取りの連続した項目だけを入れる
+    timeline_entry entries[TIMELINE_FRAME_ENTRIES];
+    uint8_t payload[EVENT_FRAME_PAYLOAD_MAX];
+    int n = 0;
+    int first = 0;
+    int index = 0;
+
+    for (int i = 0; i < timeline.entries(); i++) {
+        timeline_entry e;
+        timeline.read(i, &e);
+        if (e.stage == TIMELINE_TAP) {
+            index = 0;
+        }
+        if ((n > 0) && ((index == 0) || (n == TIMELINE_FRAME_ENTRIES))) {
+            send_frame(EVENT_TIMELINE, payload, timeline_pack(entries, n, first, payload));
+            n = 0;
+        }
+        if (n == 0) {
+            first = index;
+        }
+        entries[n++] = e;
+        index++;
+    }
+    if (n > 0) {
+        send_frame(EVENT_TIMELINE, payload, timeline_pack(entries, n, first, payload));
+    }
+#endif
+    report_station_cache();
+}
+
+// 駅名キャッシュのヒットとミスの回数（起動してからの合計）
+void report_station_cache(void) {
+    uint32_t hits = render.cache().hits();
+    uint32_t misses = render.cache().misses();
+#if USB_OUTPUT == USB_OUTPUT_TEXT
+    usb_out.printf("station cache hits=%lu misses=%lu\n", (unsigned long)hits, (unsigned long)misses);
+#else
+    uint8_t payload[EVENT_CACHE_STATS_SIZE];
+    for (int i = 0; i < 4; i++) {
+        payload[i] = (uint8_t)(hits >> (i * 8));
+        payload[4 + i] = (uint8_t)(misses >> (i * 8));
+    }
+    send_frame(EVENT_CACHE_STATS, payload, sizeof(payload));
+#endif
+}
+
+#if IDM_SCAN
+// IDmだけを読み取るモード（サービスの問い合わせ、履歴の読み出し、印刷はしない）
+void run_scan(void) {
+    uint32_t reported = 0;
+
+    lcd_out.begin();
+    lcd_out.clear();
+    lcd_out.printf(0, 0, "Scan");
+    lcd_out.printf(0, 1, "%8lu", 0UL);
+    lcd_out.end();
+    rcs620s.timeout = COMMAND_TIMEOUT;
+
     while (1) {
-        if (sc_utf8[0 + offset] == area &&
-            sc_utf8[1 + offset] == line &&
-            sc_utf8[2 + offset] == station) {
-            snprintf(buf, 80, "%s線 %s駅", &sc_utf8[3 + offset], &sc_utf8[3 + 40 + offset]);
-            ret = 0;
-            break;
+        uint32_t now = std::chrono::duration_cast<std::chrono::milliseconds>(poll_timer.elapsed_time()).count();
+
+        // 最も速いワイルドカードのポーリングだけ（RFは止めない）
+        if (rcs620s.polling(WILDCARD_SYSTEM_CODE)) {
+            if (scanner.found(rcs620s.idm, now)) {
+                send_scan(rcs620s.idm, now);
+                lcd_out.begin();
+                lcd_out.printf(0, 1, "%8lu", (unsigned long)scanner.counters().cards);
+                lcd_out.end();
+                led = !led;
+            }
         }
         else {
-            offset += record_length;
+            scanner.missed();
         }
+        if ((now - reported) >= SCAN_REPORT_INTERVAL) {
+            report_scan(now);
+            reported = now;
+        }
+        report_usb_drops();
+        check_usb_command();
+        // 出力のスレッドに順番を回す
+        ThisThread::sleep_for(1ms);
+    }
+}
 
-        if (offset >= sc_utf8_len) {
-            ret = -1;
-            break;
+void send_scan(const uint8_t *id, uint32_t now) {
+#if USB_OUTPUT == USB_OUTPUT_TEXT
+    ReceiptLine line;
+    line.dec(now / 1000);
+    line.add('.');
+    line.dec(now % 1000, 3, '0');
+    add_id(&line, " IDm: ", id);
+    line.newline();
+    serial_sink.write(line);
+#else
+    uint32_t number = scanner.counters().cards;
+    uint8_t payload[EVENT_SCAN_SIZE];
+    for (int i = 0; i < 4; i++) {
+        payload[i] = (uint8_t)(number >> (i * 8));
+        payload[4 + i] = (uint8_t)(now >> (i * 8));
+    }
+    memcpy(&payload[8], id, 8);
+    send_frame(EVENT_SCAN, payload, sizeof(payload));
+#endif
+}
+
+// スキャンの回数と読み取ったカードの数を知らせる
+void report_scan(uint32_t now) {
+    const scan_counters &c = scanner.counters();
+
+#if USB_OUTPUT == USB_OUTPUT_TEXT
+    // 前回からの回数（バイナリ出力では合計だけを送り、ホストで計算する）
+    static scan_counters last;
+    static uint32_t last_time = 0;
+    uint32_t elapsed = now - last_time;
+    if (elapsed == 0) {
+        return;
+    }
+    usb_out.printf("スキャン: %lu 回/秒, カード %lu 枚/分 (合計 %lu 枚, 重複 %lu 回)\n",
+                   (unsigned long)((c.polls - last.polls) * 1000 / elapsed),
+                   (unsigned long)((c.cards - last.cards) * 60000 / elapsed),
+                   (unsigned long)c.cards, (unsigned long)c.repeats);
+    last = c;
+    last_time = now;
+#else
+    const uint32_t values[5] = { now, c.polls, c.hits, c.cards, c.repeats };
+    uint8_t payload[EVENT_SCAN_STATS_SIZE];
+    for (int i = 0; i < 5; i++) {
+        for (int j = 0; j < 4; j++) {
+            payload[i * 4 + j] = (uint8_t)(values[i] >> (j * 8));
         }
     }
-    return ret;
+    send_frame(EVENT_SCAN_STATS, payload, sizeof(payload));
+#endif
 }
+#endif
 
-void get_bus_name(char *buf, int code) {
-    switch(code) {
-        case 0x090C:
-            strcat(buf, "函館バス");
-            break;
-        case 0x090D:
-            strcat(buf, "岩手県交通");
-            break;
-        case 0x0C0C:
-            strcat(buf, "関東自動車");
-            break;
-        case 0x0C6B:
-            strcat(buf, "神奈中バス");
-            break;
-        case 0x0C85:
-            strcat(buf, "東急世田谷線");
-            break;
-        case 0x0C8A:
-            strcat(buf, "JR東日本");
-            break;
-        case 0xA001:
-            strcat(buf, "西鉄バス");
-            break;
-        default:
-            strcat(buf, "不明");
-            break;
+// 印刷ジョブの状態を知らせる（bare-metalではここで印刷も進める）
+void report_print_jobs(void) {
+    print_job_status status;
+
+#if !MBED_CONF_RTOS_PRESENT
+    spooler.poll();
+#endif
+    while (spooler.status(&status)) {
+#if USB_OUTPUT == USB_OUTPUT_TEXT
+        // 文字出力では結果だけ
+        static const char *const states[] = { "受付", "印刷中", "完了", "破棄" };
+        if ((status.state != PRINT_JOB_DONE) && (status.state != PRINT_JOB_DROPPED)) {
+            continue;
+        }
+        usb_out.printf("印刷ジョブ %lu: %s (%u バイト)\n", (unsigned long)status.id, states[status.state], status.size);
+#else
+        uint8_t payload[EVENT_PRINT_SIZE];
+        for (int i = 0; i < 4; i++) {
+            payload[i] = (uint8_t)(status.id >> (i * 8));
+        }
+        payload[4] = status.state;
+        payload[5] = (uint8_t)status.size;
+        payload[6] = (uint8_t)(status.size >> 8);
+        send_frame(EVENT_PRINT, payload, sizeof(payload));
+#endif
     }
 }
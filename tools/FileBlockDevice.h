@@ -0,0 +1,68 @@
+/* File backed block device for host builds
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Implements the part of mbed::BlockDevice that StationDBFile uses, so
+ * the block device path can be exercised on Linux against an image file.
+ */
+
+#ifndef FILE_BLOCK_DEVICE_H_
+#define FILE_BLOCK_DEVICE_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+typedef uint64_t bd_addr_t;
+typedef uint64_t bd_size_t;
+
+class FileBlockDevice
+{
+public:
+    FileBlockDevice(const char *path, bd_size_t read_size = 1) :
+        _fp(fopen(path, "rb")),
+        _read_size(read_size),
+        _size(0)
+    {
+        /* the file is treated as a partition padded to whole read units */
+        if ((_fp != NULL) && (fseek(_fp, 0, SEEK_END) == 0)) {
+            _size = ((bd_size_t)ftell(_fp) + _read_size - 1) / _read_size * _read_size;
+        }
+    }
+
+    ~FileBlockDevice()
+    {
+        if (_fp != NULL) {
+            fclose(_fp);
+        }
+    }
+
+    /* same contract as mbed::BlockDevice: whole read units inside the device */
+    int read(void *buffer, bd_addr_t addr, bd_size_t size)
+    {
+        if ((_fp == NULL) || (addr % _read_size) || (size % _read_size) ||
+            (addr + size > _size) ||
+            (fseek(_fp, (long)addr, SEEK_SET) != 0)) {
+            return -1;
+        }
+        size_t n = fread(buffer, 1, size, _fp);
+        memset((uint8_t *)buffer + n, 0xFF, size - n);
+        return 0;
+    }
+
+    bd_size_t get_read_size() const
+    {
+        return _read_size;
+    }
+
+    bd_size_t size() const
+    {
+        return _size;
+    }
+
+private:
+    FILE *_fp;
+    bd_size_t _read_size;
+    bd_size_t _size;
+};
+
+#endif /* !FILE_BLOCK_DEVICE_H_ */
@@ -0,0 +1,508 @@
+/* Station lookup benchmark (host)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Measures station name lookups: the original get_station_name() (linear
+ * scan of the legacy sc_utf8 table, "%s線 %s駅" through snprintf) against
+ * StationDB with and without StationCache, whose names are appended to a
+ * ReceiptLine as HistoryRender::stationName() does.
+ * Prints one JSON object per line:
+ *   {"impl": ..., "case": ..., "lookups": ..., "ns_per_lookup": ...,
+ *    "bytes_touched": ..., "footprint": ...}
+ * bytes_touched is the number of distinct 64-byte cache lines read per
+ * lookup (times 64), averaged over the keys of the case; for the cache
+ * it is taken on a second pass over the keys, as the timing loop runs
+ * with a warm cache. An optional argument runs a single case (hit, miss,
+ * worst, history or name); --corpus gives the history corpus, by default
+ * tools/history_corpus.txt.
+ *
+ * The history case is the station lookups the Suica records of the corpus
+ * make when they are rendered, oldest record first as on a tap.
+ *
+ * The name case times reverse lookups (StationDB::findName) of existing
+ * station names, exact and by their first character:
+ *   {"bench": "station_name", "impl": ..., "case": "exact"|"prefix", ...}
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "../History.h"
+#include "../ReceiptLine.h"
+#include "../StationData.h"
+#include "../StationDB.h"
+#include "../StationCache.h"
+
+#define LEGACY_RECORD_LENGTH    (3 + 40 + 40)
+#define CACHE_LINE              64
+#define MIN_DURATION_NS         200000000LL
+#define BLOCKS_MAX              20
+
+#ifndef HISTORY_CORPUS
+#define HISTORY_CORPUS          "history_corpus.txt"
+#endif
+
+struct key {
+    int area;
+    int line;
+    int station;
+};
+
+/* ------------------------
+ * implementations under test
+ * ------------------------ */
+
+/* the original get_station_name() */
+static int legacy_lookup(char *buf, int area, int line, int station)
+{
+    unsigned int offset = 0;
+    while (1) {
+        if (sc_utf8[0 + offset] == area &&
+            sc_utf8[1 + offset] == line &&
+            sc_utf8[2 + offset] == station) {
+            snprintf(buf, 80, "%s線 %s駅", &sc_utf8[3 + offset], &sc_utf8[3 + 40 + offset]);
+            return 0;
+        }
+        offset += LEGACY_RECORD_LENGTH;
+        if (offset >= sc_utf8_len) {
+            return -1;
+        }
+    }
+}
+
+static StationDB compact_db;
+static StationCache compact_cache;
+static StationCache model_cache;            // replays the keys for cached_touched()
+
+/* as HistoryRender::stationName() adds a found station to the line */
+static void add_name(char *buf, const char *line_name, const char *name)
+{
+    ReceiptLine out;
+
+    out.append(line_name, line_name);
+    out.format(LABEL_LINE);
+    out.append(name, name);
+    out.format(LABEL_STATION);
+    buf[0] = out.text()[0];
+}
+
+static int compact_lookup(char *buf, int area, int line, int station)
+{
+    station_ref ref;
+    if (!compact_db.find(area, line, station, &ref)) {
+        return -1;
+    }
+    add_name(buf, compact_db.lineName(ref), compact_db.stationName(ref));
+    return 0;
+}
+
+static int cached_lookup(char *buf, int area, int line, int station)
+{
+    const char *line_name;
+    const char *name;
+    if (!compact_cache.find(&compact_db, 1, area, line, station, &line_name, &name)) {
+        return -1;
+    }
+    add_name(buf, line_name, name);
+    return 0;
+}
+
+/* ------------------------
+ * memory access models
+ * ------------------------ */
+
+static void touch(std::set<uintptr_t> &lines, const void *p, size_t len)
+{
+    uintptr_t a = (uintptr_t)p;
+    for (uintptr_t l = a / CACHE_LINE; l <= (a + len - 1) / CACHE_LINE; l++) {
+        lines.insert(l);
+    }
+}
+
+static size_t legacy_touched(const key &k)
+{
+    std::set<uintptr_t> lines;
+    unsigned int offset = 0;
+    while (offset < sc_utf8_len) {
+        touch(lines, &sc_utf8[offset], 3);
+        if (sc_utf8[0 + offset] == k.area &&
+            sc_utf8[1 + offset] == k.line &&
+            sc_utf8[2 + offset] == k.station) {
+            touch(lines, &sc_utf8[offset + 3], strlen((const char *)&sc_utf8[offset + 3]) + 1);
+            touch(lines, &sc_utf8[offset + 43], strlen((const char *)&sc_utf8[offset + 43]) + 1);
+            break;
+        }
+        offset += LEGACY_RECORD_LENGTH;
+    }
+    return lines.size() * CACHE_LINE;
+}
+
+static void touch_names(std::set<uintptr_t> &lines, const station_ref &ref)
+{
+    const station_db_header *h = (const station_db_header *)sc_compact;
+    const char *line_name = (const char *)sc_compact + h->line_pool_offset + ref.line_name;
+    const char *name = (const char *)sc_compact + h->name_pool_offset + ref.name;
+
+    touch(lines, line_name, strlen(line_name) + 1);
+    touch(lines, name, strlen(name) + 1);
+}
+
+/* mirrors StationDB::find() */
+static void compact_touch(std::set<uintptr_t> &lines, const key &k)
+{
+    const station_db_header *h = (const station_db_header *)sc_compact;
+    const station_db_run *runs = (const station_db_run *)(sc_compact + h->run_offset);
+    const uint8_t *codes = sc_compact + h->code_offset;
+    const uint8_t *names = sc_compact + h->name_offset;
+    uint32_t target = ((uint32_t)k.area << 16) | ((uint32_t)k.line << 8) | (uint32_t)k.station;
+
+    touch(lines, h, sizeof(*h));
+    int lo = 0, hi = h->run_count - 1, run = -1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        touch(lines, &runs[mid], sizeof(runs[mid]));
+        uint32_t rk = ((uint32_t)runs[mid].area << 16) | ((uint32_t)runs[mid].line << 8) | runs[mid].station;
+        if (rk <= target) {
+            run = mid;
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    if ((run < 0) || (runs[run].area != k.area) || (runs[run].line != k.line)) {
+        return;
+    }
+    lo = runs[run].first;
+    hi = ((run + 1) < h->run_count ? runs[run + 1].first : h->station_count) - 1;
+    if (run + 1 < h->run_count) {
+        touch(lines, &runs[run + 1], sizeof(runs[run + 1]));
+    }
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        touch(lines, &codes[mid], 1);
+        if (codes[mid] == k.station) {
+            const uint8_t *offset = &names[mid * 3];
+            station_ref ref;
+            ref.line_name = runs[run].line_name;
+            ref.name = offset[0] | (offset[1] << 8) | ((uint32_t)offset[2] << 16);
+            touch(lines, offset, 3);
+            touch_names(lines, ref);
+            break;
+        } else if (codes[mid] < k.station) {
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+}
+
+static size_t compact_touched(const key &k)
+{
+    std::set<uintptr_t> lines;
+    compact_touch(lines, k);
+    return lines.size() * CACHE_LINE;
+}
+
+/*
+ * model_cache takes the same keys in the same order as the measured cache,
+ * so it holds what that one holds. A lookup reads the counters, keys and
+ * flags at the front of the object, then the names of the entry on a hit,
+ * or the whole StationDB::find() and the names it copies on a miss.
+ */
+static size_t cached_touched(const key &k)
+{
+    std::set<uintptr_t> lines;
+    const char *line_name;
+    const char *name;
+    uint32_t misses = model_cache.misses();
+
+    touch(lines, &model_cache, 5 * sizeof(uint32_t) + STATION_CACHE_SIZE * (sizeof(uint32_t) + 1));
+    int found = model_cache.find(&compact_db, 1, k.area, k.line, k.station, &line_name, &name);
+    if (model_cache.misses() != misses) {
+        compact_touch(lines, k);
+    }
+    if (found) {
+        touch(lines, line_name, strlen(line_name) + 1);
+        touch(lines, name, strlen(name) + 1);
+    }
+    return lines.size() * CACHE_LINE;
+}
+
+/* ------------------------
+ * key sets
+ * ------------------------ */
+
+static void all_keys(std::vector<key> &keys)
+{
+    std::set<uint32_t> seen;
+    for (unsigned int offset = 0; offset < sc_utf8_len; offset += LEGACY_RECORD_LENGTH) {
+        uint32_t k = (sc_utf8[offset] << 16) | (sc_utf8[offset + 1] << 8) | sc_utf8[offset + 2];
+        if (seen.insert(k).second) {
+            key e = { sc_utf8[offset], sc_utf8[offset + 1], sc_utf8[offset + 2] };
+            keys.push_back(e);
+        }
+    }
+}
+
+static void hit_keys(std::vector<key> &keys)
+{
+    std::vector<key> all;
+    all_keys(all);
+    srand(1);
+    for (int i = 0; i < 1024; i++) {
+        keys.push_back(all[rand() % all.size()]);
+    }
+}
+
+static void miss_keys(std::vector<key> &keys)
+{
+    char buf[80];
+    srand(2);
+    while (keys.size() < 256) {
+        key k = { rand() % 4, rand() % 256, rand() % 256 };
+        if (legacy_lookup(buf, k.area, k.line, k.station) != 0) {
+            keys.push_back(k);
+        }
+    }
+}
+
+static void worst_keys(std::vector<key> &keys)
+{
+    unsigned int offset = sc_utf8_len - LEGACY_RECORD_LENGTH;
+    key k = { sc_utf8[offset], sc_utf8[offset + 1], sc_utf8[offset + 2] };
+    keys.push_back(k);
+}
+
+static const char *corpus_path = HISTORY_CORPUS;
+
+/* station lookups of HistoryRender::cyberne() for one record, bus stops left out */
+static void record_keys(const history_record *rec, std::vector<key> &keys)
+{
+    key in = { rec->region_in, rec->line_in, rec->station_in };
+    key out = { rec->region_out, rec->line_out, rec->station_out };
+
+    switch (rec->process) {
+        case 0x02:
+        case 0x03:
+            keys.push_back(in);
+            break;
+        case 0x07:
+            if ((rec->line_in != 0) || (rec->station_in != 0)) {
+                keys.push_back(in);
+            }
+            break;
+        case 0x13:
+            keys.push_back(in);
+            keys.push_back(out);
+            break;
+    }
+    if ((rec->process == 0x01) || (rec->process == 0x14)) {
+        switch (rec->gate) {
+            case 0x01:
+            case 0x03:
+            case 0x08:
+                keys.push_back(in);
+                break;
+            case 0x02:
+            case 0x04:
+            case 0x05:
+            case 0x17:
+            case 0x1D:
+            case 0x22:
+            case 0x25:
+            case 0x26:
+                keys.push_back(in);
+                keys.push_back(out);
+                break;
+        }
+    }
+}
+
+static void flush_tap(uint8_t blocks[][HISTORY_BLOCK_SIZE], int count, std::vector<key> &keys)
+{
+    history_record records[BLOCKS_MAX];
+
+    history_decode_batch(HISTORY_CYBERNE, blocks, count, records);
+    for (int i = count - 1; i >= 0; i--) {
+        if (records[i].flags & HISTORY_VALID) {
+            record_keys(&records[i], keys);
+        }
+    }
+}
+
+/* the Suica taps of tools/history_corpus.txt, see bench_history.cpp for the format */
+static void history_keys(std::vector<key> &keys)
+{
+    FILE *fp = fopen(corpus_path, "r");
+    char buf[512];
+    uint8_t blocks[BLOCKS_MAX][HISTORY_BLOCK_SIZE];
+    int count = 0;
+    int cyberne = 0;
+
+    if (fp == NULL) {
+        perror(corpus_path);
+        return;
+    }
+    while (fgets(buf, sizeof(buf), fp) != NULL) {
+        if (strncmp(buf, "card ", 5) == 0) {
+            flush_tap(blocks, count, keys);
+            count = 0;
+            cyberne = (strncmp(buf + 5, "cyberne", 7) == 0);
+        }
+        else if (cyberne && (strncmp(buf, "block ", 6) == 0) && (count < BLOCKS_MAX)) {
+            const char *p = buf + 6;
+            unsigned int v;
+            int n;
+            int len = 0;
+            while ((len < HISTORY_BLOCK_SIZE) && (sscanf(p, " %2x%n", &v, &n) == 1)) {
+                blocks[count][len++] = (uint8_t)v;
+                p += n;
+            }
+            count += (len == HISTORY_BLOCK_SIZE);
+        }
+    }
+    flush_tap(blocks, count, keys);
+    fclose(fp);
+}
+
+/* ------------------------
+ * runner
+ * ------------------------ */
+
+typedef int (*lookup_fn)(char *buf, int area, int line, int station);
+typedef size_t (*touch_fn)(const key &k);
+
+static void run(const char *impl, const char *name, lookup_fn fn, touch_fn touched,
+                size_t footprint, const std::vector<key> &keys)
+{
+    char buf[80];
+    volatile int sink = 0;
+    long long lookups = 0;
+    long long elapsed = 0;
+
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    do {
+        for (size_t i = 0; i < keys.size(); i++) {
+            sink += fn(buf, keys[i].area, keys[i].line, keys[i].station);
+        }
+        lookups += keys.size();
+        elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      std::chrono::steady_clock::now() - t0).count();
+    } while (elapsed < MIN_DURATION_NS);
+
+    double sum = 0;
+    for (size_t i = 0; i < keys.size(); i++) {
+        sum += touched(keys[i]);
+    }
+
+    printf("{\"bench\": \"station_lookup\", \"impl\": \"%s\", \"case\": \"%s\", \"lookups\": %lld, "
+           "\"ns_per_lookup\": %.1f, \"bytes_touched\": %.0f, \"footprint\": %zu}\n",
+           impl, name, lookups, (double)elapsed / lookups, sum / keys.size(), footprint);
+    fflush(stdout);
+}
+
+static void run_names(const char *name, int match, const std::vector<std::string> &keys)
+{
+    station_code codes[16];
+    volatile int sink = 0;
+    long long lookups = 0;
+    long long matches = 0;
+    long long elapsed = 0;
+
+    std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    do {
+        for (size_t i = 0; i < keys.size(); i++) {
+            int n = compact_db.findName(keys[i].c_str(), match, codes, 16);
+            sink += n;
+            matches += n;
+        }
+        lookups += keys.size();
+        elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      std::chrono::steady_clock::now() - t0).count();
+    } while (elapsed < MIN_DURATION_NS);
+
+    printf("{\"bench\": \"station_name\", \"impl\": \"compact\", \"case\": \"%s\", \"lookups\": %lld, "
+           "\"ns_per_lookup\": %.1f, \"matches_per_lookup\": %.1f, \"footprint\": %u}\n",
+           name, lookups, (double)elapsed / lookups, (double)matches / lookups, sc_compact_len);
+    fflush(stdout);
+}
+
+static void name_keys(std::vector<std::string> &exact, std::vector<std::string> &prefix)
+{
+    std::vector<key> keys;
+    station_ref ref;
+    hit_keys(keys);
+    for (size_t i = 0; i < keys.size(); i++) {
+        if (compact_db.find(keys[i].area, keys[i].line, keys[i].station, &ref)) {
+            std::string name = compact_db.stationName(ref);
+            exact.push_back(name);
+            prefix.push_back(name.substr(0, 3));    // first character
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (!compact_db.open(sc_compact, sc_compact_len)) {
+        fprintf(stderr, "sc_compact: not a valid station database\n");
+        return 1;
+    }
+
+    struct {
+        const char *name;
+        void (*make)(std::vector<key> &keys);
+    } cases[] = {
+        { "hit", hit_keys },
+        { "miss", miss_keys },
+        { "worst", worst_keys },
+        { "history", history_keys },
+    };
+    const char *only = NULL;
+    for (int i = 1; i < argc; i++) {
+        if ((strcmp(argv[i], "--corpus") == 0) && (i + 1 < argc)) {
+            corpus_path = argv[++i];
+        }
+        else if ((argv[i][0] != '-') && (only == NULL)) {
+            only = argv[i];
+        }
+        else {
+            fprintf(stderr, "usage: bench-station [--corpus <history_corpus.txt>] [hit|miss|worst|history|name]\n");
+            return 2;
+        }
+    }
+
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        if ((only != NULL) && (strcmp(only, cases[c].name) != 0)) {
+            continue;
+        }
+        std::vector<key> keys;
+        cases[c].make(keys);
+        if (keys.empty()) {
+            fprintf(stderr, "bench-station: no keys for %s\n", cases[c].name);
+            return 1;
+        }
+        run("legacy", cases[c].name, legacy_lookup, legacy_touched, sc_utf8_len, keys);
+        run("compact", cases[c].name, compact_lookup, compact_touched, sc_compact_len, keys);
+        compact_cache.clear();
+        model_cache.clear();
+        for (size_t i = 0; i < keys.size(); i++) {
+            cached_touched(keys[i]);
+        }
+        run("compact+cache", cases[c].name, cached_lookup, cached_touched,
+            sc_compact_len + sizeof(StationCache), keys);
+    }
+
+    if ((only == NULL) || (strcmp(only, "name") == 0)) {
+        std::vector<std::string> exact, prefix;
+        name_keys(exact, prefix);
+        run_names("exact", STATION_DB_EXACT, exact);
+        run_names("prefix", STATION_DB_PREFIX, prefix);
+    }
+
+    return 0;
+}
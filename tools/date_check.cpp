@@ -0,0 +1,168 @@
+/* Exhaustive check of DateTime.h against the C library (host)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Compares every date conversion and every packed card timestamp with
+ * gmtime() and with the field layout of each card format.
+ * Prints one line per check and exits non-zero if any value differs.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "../DateTime.h"
+
+#define UNIX_2000                     946684800L  // 2000-01-01 00:00:00 UTC
+
+static long failures;
+
+static int same(const date_time &dt, const struct tm &tm, bool with_time)
+{
+    if ((dt.year != tm.tm_year + 1900) || (dt.month != tm.tm_mon + 1) || (dt.day != tm.tm_mday)) {
+        return 0;
+    }
+    if (with_time && ((dt.hour != tm.tm_hour) || (dt.minute != tm.tm_min) || (dt.second != tm.tm_sec))) {
+        return 0;
+    }
+    return 1;
+}
+
+static int fail(const char *check, unsigned long value)
+{
+    if (failures++ < 10) {
+        fprintf(stderr, "%s: mismatch at 0x%lx\n", check, value);
+    }
+    return 0;
+}
+
+static void report(const char *check, unsigned long count)
+{
+    printf("%-24s %lu %s\n", check, count, (failures == 0) ? "ok" : "FAILED");
+}
+
+/* days_from_civil() and civil_from_days() for 0001-01-01 to 9999-12-31 */
+static void check_civil(void)
+{
+    int32_t first = days_from_civil(1, 1, 1);
+    int32_t last = days_from_civil(9999, 12, 31);
+    unsigned long count = 0;
+
+    for (int32_t days = first; days <= last; days++, count++) {
+        time_t t = (time_t)UNIX_2000 + (time_t)days * 86400;
+        struct tm tm;
+        gmtime_r(&t, &tm);
+        date_time dt = civil_from_days(days);
+        if (!same(dt, tm, false) || (days_from_civil(dt.year, dt.month, dt.day) != days)
+                || (dt.day > days_in_month(dt.year, dt.month))) {
+            fail("civil", (unsigned long)days);
+        }
+    }
+    report("civil", count);
+}
+
+/* CJRC date and sales time, all 16-bit values */
+static void check_cjrc(void)
+{
+    for (uint32_t v = 0; v < 0x10000; v++) {
+        uint8_t p[2] = { (uint8_t)(v >> 8), (uint8_t)v };
+        date_time d = decode_date_cjrc(p);
+        date_time t = decode_time_cjrc(p);
+        if ((d.year != 2000 + (v >> 9)) || (d.month != ((v >> 5) & 0x0f)) || (d.day != (v & 0x1f))
+                || (t.hour != (v >> 11)) || (t.minute != ((v >> 5) & 0x3f)) || (t.second != (v & 0x1f))) {
+            fail("cjrc", v);
+        }
+    }
+    report("cjrc", 0x10000);
+}
+
+/* ecomyca start and end time, all 24-bit values */
+static void check_ecomyca(void)
+{
+    for (uint32_t v = 0; v < 0x1000000; v++) {
+        uint8_t p[3] = { (uint8_t)(v >> 16), (uint8_t)(v >> 8), (uint8_t)v };
+        date_time s = decode_time_ecomyca(p, 0);
+        date_time e = decode_time_ecomyca(p, 1);
+        if ((s.hour != (v >> 18)) || (s.minute != ((v >> 12) & 0x3f))
+                || (e.hour != ((v >> 6) & 0x3f)) || (e.minute != (v & 0x3f))) {
+            fail("ecomyca", v);
+        }
+    }
+    report("ecomyca", 0x1000000);
+}
+
+static void check_edy_value(uint32_t day, uint32_t sec)
+{
+    uint32_t v = (day << 17) | sec;
+    uint8_t p[4] = { (uint8_t)(v >> 24), (uint8_t)(v >> 16), (uint8_t)(v >> 8), (uint8_t)v };
+    time_t t = (time_t)UNIX_2000 + (time_t)day * 86400 + sec;
+    struct tm tm;
+
+    gmtime_r(&t, &tm);
+    if (!same(decode_date_time_edy(p), tm, true)) {
+        fail("edy", v);
+    }
+}
+
+/* Edy: every day with the edge seconds, and every second of the first and last day */
+static void check_edy(void)
+{
+    static const uint32_t seconds[] = { 0, 1, 59, 3599, 43200, 86399, 86400, 131071 };
+    unsigned long count = 0;
+
+    for (uint32_t day = 0; day < 0x8000; day++) {
+        for (size_t i = 0; i < sizeof(seconds) / sizeof(seconds[0]); i++, count++) {
+            check_edy_value(day, seconds[i]);
+        }
+    }
+    for (uint32_t sec = 0; sec < 0x20000; sec++, count += 2) {
+        check_edy_value(0, sec);
+        check_edy_value(0x7fff, sec);
+    }
+    report("edy", count);
+}
+
+/* nanaco and WAON, every field combination of the packed layouts */
+static void check_nanaco_waon(void)
+{
+    unsigned long count = 0;
+
+    for (uint32_t year = 0; year < 0x800; year++) {
+        for (uint32_t month = 0; month < 16; month++) {
+            for (uint32_t day = 0; day < 32; day++) {
+                for (uint32_t hm = 0; hm < 0x1000; hm++) {
+                    uint32_t v = (year << 21) | (month << 17) | (day << 12) | hm;
+                    uint8_t p[4] = { (uint8_t)(v >> 24), (uint8_t)(v >> 16), (uint8_t)(v >> 8), (uint8_t)v };
+                    date_time dt = decode_date_time_nanaco(p);
+                    if ((dt.year != 2000 + year) || (dt.month != month) || (dt.day != day)
+                            || (dt.hour != (hm >> 6)) || (dt.minute != (hm & 0x3f))) {
+                        fail("nanaco", v);
+                    }
+                    count++;
+                }
+            }
+        }
+    }
+    report("nanaco", count);
+
+    for (uint32_t v = 0; v < 0x2000000; v++) {
+        uint32_t w = v << 7;    // 25 bits from the MSB of p[0]
+        uint8_t p[4] = { (uint8_t)(w >> 24), (uint8_t)(w >> 16), (uint8_t)(w >> 8), (uint8_t)w };
+        date_time dt = decode_date_time_waon(p);
+        if ((dt.year != 2005 + (v >> 20)) || (dt.month != ((v >> 16) & 0x0f)) || (dt.day != ((v >> 11) & 0x1f))
+                || (dt.hour != ((v >> 6) & 0x1f)) || (dt.minute != (v & 0x3f))) {
+            fail("waon", v);
+        }
+    }
+    report("waon", 0x2000000);
+}
+
+int main(void)
+{
+    check_civil();
+    check_cjrc();
+    check_ecomyca();
+    check_edy();
+    check_nanaco_waon();
+
+    return (failures == 0) ? 0 : 1;
+}
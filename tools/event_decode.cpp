@@ -0,0 +1,210 @@
+/* Decoder for the binary USB serial output (host)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Reads the frames written with usb-output 1 or 2 from a file, a serial
+ * device (after "stty -F /dev/ttyACM0 raw") or stdin, and prints one
+ * JSON object per frame (per entry for timeline frames).
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "../EventFrame.h"
+#include "../History.h"
+#include "../Timeline.h"
+
+static void usage(void)
+{
+    fprintf(stderr,
+            "usage: event-decode [<file>]\n"
+            "\n"
+            "  <file>           captured output or serial device (default: stdin)\n");
+}
+
+static void print_hex(const uint8_t *p, int len)
+{
+    putchar('"');
+    for (int i = 0; i < len; i++) {
+        printf("%02x", p[i]);
+    }
+    putchar('"');
+}
+
+static uint32_t le32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void print_card(const uint8_t *p, int len)
+{
+    if (len < EVENT_CARD_SIZE) {
+        printf("{\"event\":\"card\",\"error\":\"short\"}\n");
+        return;
+    }
+    printf("{\"event\":\"card\",\"card\":%d,\"idm\":", p[0]);
+    print_hex(&p[1], 8);
+    printf(",\"balance\":%u,\"name\":\"%.*s\"}\n", le32(&p[9]), len - EVENT_CARD_SIZE, (const char *)&p[EVENT_CARD_SIZE]);
+}
+
+static void print_timeline(const uint8_t *p, int len)
+{
+    timeline_entry entries[TIMELINE_FRAME_ENTRIES];
+    int first;
+    int n = timeline_unpack(p, len, &first, entries);
+
+    if (n < 0) {
+        printf("{\"event\":\"timeline\",\"error\":\"length\"}\n");
+        return;
+    }
+    for (int i = 0; i < n; i++) {
+        printf("{\"event\":\"timeline\",\"tap\":%u,\"index\":%d,\"stage\":\"%s\",\"depth\":%u,"
+               "\"start_us\":%u,\"duration_us\":%u}\n",
+               entries[i].tap, first + i, timeline_stage_name(entries[i].stage), entries[i].depth,
+               entries[i].start, entries[i].duration);
+    }
+}
+
+static void print_record(const uint8_t *p, int len)
+{
+    history_record rec;
+
+    if (!history_unpack(p, len, &rec)) {
+        printf("{\"event\":\"record\",\"error\":\"short\"}\n");
+        return;
+    }
+    printf("{\"event\":\"record\",\"card\":%d,\"terminal\":%d,\"process\":%d",
+           rec.card, rec.terminal, rec.process);
+    printf(",\"date\":\"%04d-%02d-%02d\"", rec.year, rec.month, rec.day);
+    if (rec.flags & HISTORY_TIME) {
+        printf(",\"time\":\"%02d:%02d", rec.hour, rec.minute);
+        if (rec.flags & HISTORY_SECOND) {
+            printf(":%02d", rec.second);
+        }
+        putchar('"');
+    }
+    if (rec.flags & HISTORY_END_TIME) {
+        printf(",\"end_time\":\"%02d:%02d\"", rec.end_hour, rec.end_minute);
+    }
+    if (rec.card == HISTORY_CYBERNE) {
+        printf(",\"gate\":%d,\"in\":[%d,%d,%d],\"out\":[%d,%d,%d]", rec.gate,
+               rec.region_in, rec.line_in, rec.station_in,
+               rec.region_out, rec.line_out, rec.station_out);
+    }
+    if (rec.flags & HISTORY_AMOUNT) {
+        printf(",\"amount\":%d", (int)rec.amount);
+    }
+    if (rec.flags & HISTORY_CHARGE) {
+        printf(",\"charge\":%u", rec.charge);
+    }
+    if (rec.flags & HISTORY_SEQUENCE) {
+        printf(",\"sequence\":%d", rec.sequence);
+    }
+    printf(",\"balance\":%u}\n", rec.balance);
+}
+
+static void print_frame(const EventFrameParser &parser)
+{
+    const uint8_t *p = parser.payload();
+    int len = parser.length();
+    switch (parser.type()) {
+        case EVENT_CARD:
+            print_card(p, len);
+            break;
+        case EVENT_RECORD:
+            print_record(p, len);
+            break;
+        case EVENT_RAW:
+            printf("{\"event\":\"raw\",\"card\":%d,\"data\":", (len > 0) ? p[0] : -1);
+            print_hex(p + 1, (len > 0) ? len - 1 : 0);
+            printf("}\n");
+            break;
+        case EVENT_DROPPED:
+            if (len >= EVENT_DROPPED_SIZE) {
+                printf("{\"event\":\"dropped\",\"bytes\":%u,\"overflows\":%u}\n", le32(p), le32(p + 4));
+            }
+            break;
+        case EVENT_PRINT:
+            if (len >= EVENT_PRINT_SIZE) {
+                static const char *const states[] = { "queued", "printing", "done", "dropped" };
+                printf("{\"event\":\"print\",\"job\":%u,\"state\":\"%s\",\"bytes\":%u}\n", le32(p),
+                       (p[4] < 4) ? states[p[4]] : "unknown", p[5] | (p[6] << 8));
+            }
+            break;
+        case EVENT_TIMELINE:
+            print_timeline(p, len);
+            break;
+        case EVENT_SCAN:
+            if (len >= EVENT_SCAN_SIZE) {
+                printf("{\"event\":\"scan\",\"card\":%u,\"time_ms\":%u,\"idm\":", le32(p), le32(p + 4));
+                print_hex(p + 8, 8);
+                printf("}\n");
+            }
+            break;
+        case EVENT_SCAN_STATS:
+            if (len >= EVENT_SCAN_STATS_SIZE) {
+                printf("{\"event\":\"scan_stats\",\"time_ms\":%u,\"polls\":%u,\"hits\":%u,\"cards\":%u,\"repeats\":%u}\n",
+                       le32(p), le32(p + 4), le32(p + 8), le32(p + 12), le32(p + 16));
+            }
+            break;
+        case EVENT_CACHE_STATS:
+            if (len >= EVENT_CACHE_STATS_SIZE) {
+                printf("{\"event\":\"cache_stats\",\"hits\":%u,\"misses\":%u}\n", le32(p), le32(p + 4));
+            }
+            break;
+        case EVENT_PASSTHROUGH:
+            if (len >= PASSTHROUGH_RESPONSE_SIZE) {
+                printf("{\"event\":\"passthrough\",\"seq\":%u,\"op\":%u,\"status\":%u,\"wait_us\":%u,\"time_us\":%u,\"response\":",
+                       p[0], p[1], p[2], le32(&p[3]), le32(&p[7]));
+                print_hex(p + PASSTHROUGH_RESPONSE_SIZE, len - PASSTHROUGH_RESPONSE_SIZE);
+                printf("}\n");
+            }
+            break;
+        case EVENT_END:
+            printf("{\"event\":\"end\",\"records\":%d}\n", (len > 0) ? p[0] : 0);
+            break;
+        default:
+            printf("{\"event\":\"unknown\",\"type\":%d,\"data\":", parser.type());
+            print_hex(p, len);
+            printf("}\n");
+            break;
+    }
+    fflush(stdout);
+}
+
+int main(int argc, char **argv)
+{
+    FILE *fp = stdin;
+    EventFrameParser parser;
+    int c;
+
+    if (argc > 2) {
+        usage();
+        return 2;
+    }
+    if (argc == 2) {
+        if ((strcmp(argv[1], "-h") == 0) || (strcmp(argv[1], "--help") == 0)) {
+            usage();
+            return 0;
+        }
+        fp = fopen(argv[1], "rb");
+        if (fp == NULL) {
+            perror(argv[1]);
+            return 1;
+        }
+    }
+
+    while ((c = fgetc(fp)) != EOF) {
+        // a frame hidden in a damaged one can be followed by another in the bytes already read
+        for (int ready = parser.put((uint8_t)c); ready; ready = parser.next()) {
+            print_frame(parser);
+        }
+    }
+
+    if (parser.errors() != 0) {
+        fprintf(stderr, "event-decode: %u bad frames\n", parser.errors());
+    }
+    if (fp != stdin) {
+        fclose(fp);
+    }
+    return 0;
+}
@@ -0,0 +1,325 @@
+/* Passthrough client for the reader (host)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Puts the reader into passthrough mode and sends it the commands read
+ * from stdin, one per line:
+ *
+ *   rw d44a010100ffff0000          PN533 command to the RC-S620/S
+ *   card 06<idm>010b000180008001   FeliCa command without the length byte
+ *
+ * Up to --window requests are kept in flight. Each response is printed as
+ * one JSON object with the time it waited on the reader and the time the
+ * command took; a summary goes to stderr.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "../EventFrame.h"
+
+#define RESPONSE_TIMEOUT              3000        // ms without any response
+
+struct request {
+    uint8_t op;
+    uint16_t timeout;
+    std::vector<uint8_t> command;
+};
+
+struct in_flight {
+    uint8_t seq;
+    uint8_t op;
+    double sent;
+};
+
+static void usage(void)
+{
+    fprintf(stderr,
+            "usage: felica-passthrough [options] <device>\n"
+            "\n"
+            "  --window <n>     requests in flight (default: 4, the passthrough-queue default)\n"
+            "  --timeout <ms>   card command timeout (default: the firmware's)\n"
+            "  --repeat <n>     send the commands <n> times\n"
+            "\n"
+            "Commands are read from stdin, \"rw <hex>\" or \"card <hex>\" per line.\n");
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint32_t le32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static int parse_hex(const char *s, std::vector<uint8_t> &data)
+{
+    while (*s != '\0') {
+        if ((*s == ' ') || (*s == '\t') || (*s == '\n') || (*s == '\r')) {
+            s++;
+            continue;
+        }
+        unsigned int v;
+        if (sscanf(s, "%2x", &v) != 1) {
+            return 0;
+        }
+        data.push_back((uint8_t)v);
+        s += (s[1] != '\0') ? 2 : 1;
+    }
+    return 1;
+}
+
+static int read_requests(FILE *fp, uint16_t timeout, std::vector<request> &requests)
+{
+    char line[1024];
+    int number = 0;
+
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        number++;
+        char *p = line + strspn(line, " \t");
+        if ((*p == '#') || (*p == '\n') || (*p == '\r') || (*p == '\0')) {
+            continue;
+        }
+        request r;
+        r.timeout = timeout;
+        if (strncmp(p, "rw ", 3) == 0) {
+            r.op = PASSTHROUGH_RW;
+            p += 3;
+        }
+        else if (strncmp(p, "card ", 5) == 0) {
+            r.op = PASSTHROUGH_CARD;
+            p += 5;
+        }
+        else {
+            fprintf(stderr, "felica-passthrough: line %d: expected rw or card\n", number);
+            return 0;
+        }
+        if (!parse_hex(p, r.command) || r.command.empty() ||
+            (r.command.size() + PASSTHROUGH_REQUEST_SIZE > EVENT_FRAME_LENGTH_MAX)) {
+            fprintf(stderr, "felica-passthrough: line %d: bad command\n", number);
+            return 0;
+        }
+        requests.push_back(r);
+    }
+    return 1;
+}
+
+static int open_device(const char *path)
+{
+    int fd = open(path, O_RDWR | O_NOCTTY);
+    if (fd < 0) {
+        perror(path);
+        return -1;
+    }
+    struct termios tio;
+    if (tcgetattr(fd, &tio) == 0) {
+        cfmakeraw(&tio);
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+    return fd;
+}
+
+static int write_all(int fd, const uint8_t *data, size_t len)
+{
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("write");
+            return 0;
+        }
+        data += n;
+        len -= n;
+    }
+    return 1;
+}
+
+static int send_request(int fd, uint8_t seq, uint8_t op, uint16_t timeout, const std::vector<uint8_t> &command)
+{
+    uint8_t payload[EVENT_FRAME_LENGTH_MAX];
+    uint8_t frame[EVENT_FRAME_LENGTH_MAX + EVENT_FRAME_OVERHEAD];
+
+    payload[0] = seq;
+    payload[1] = op;
+    payload[2] = (uint8_t)timeout;
+    payload[3] = (uint8_t)(timeout >> 8);
+    memcpy(&payload[PASSTHROUGH_REQUEST_SIZE], command.data(), command.size());
+    int n = event_frame_encode(EVENT_PASSTHROUGH, payload, PASSTHROUGH_REQUEST_SIZE + (int)command.size(), frame, sizeof(frame));
+    return write_all(fd, frame, n);
+}
+
+static const char *op_name(uint8_t op)
+{
+    switch (op) {
+        case PASSTHROUGH_END:
+            return "end";
+        case PASSTHROUGH_RW:
+            return "rw";
+        case PASSTHROUGH_CARD:
+            return "card";
+        default:
+            return "unknown";
+    }
+}
+
+static const char *status_name(uint8_t status)
+{
+    static const char *const names[] = { "ok", "failed", "bad_request" };
+    return (status < 3) ? names[status] : "unknown";
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = NULL;
+    int window = 4;
+    int repeat = 1;
+    uint16_t timeout = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if ((strcmp(argv[i], "--window") == 0) && (i + 1 < argc)) {
+            window = atoi(argv[++i]);
+        }
+        else if ((strcmp(argv[i], "--timeout") == 0) && (i + 1 < argc)) {
+            timeout = (uint16_t)atoi(argv[++i]);
+        }
+        else if ((strcmp(argv[i], "--repeat") == 0) && (i + 1 < argc)) {
+            repeat = atoi(argv[++i]);
+        }
+        else if ((strcmp(argv[i], "-h") == 0) || (strcmp(argv[i], "--help") == 0)) {
+            usage();
+            return 0;
+        }
+        else if ((argv[i][0] != '-') && (path == NULL)) {
+            path = argv[i];
+        }
+        else {
+            usage();
+            return 2;
+        }
+    }
+    if ((path == NULL) || (window < 1) || (window > 255) || (repeat < 1)) {
+        usage();
+        return 2;
+    }
+
+    std::vector<request> requests;
+    if (!read_requests(stdin, timeout, requests)) {
+        return 1;
+    }
+    int fd = open_device(path);
+    if (fd < 0) {
+        return 1;
+    }
+
+    EventFrameParser parser;
+    std::deque<in_flight> pending;
+    size_t total = requests.size() * repeat;
+    size_t next = 0;
+    size_t ok = 0;
+    size_t lost = 0;
+    uint8_t seq = 0;
+    uint64_t rf_time = 0;
+    int ended = 0;
+    double start = now();
+
+    if (!write_all(fd, (const uint8_t *)"p", 1)) {
+        return 1;
+    }
+    while (!ended) {
+        // keep the window full, then end the session once everything was answered
+        while (((int)pending.size() < window) && (next <= total)) {
+            in_flight f = { seq++, PASSTHROUGH_END, now() };
+            if (next < total) {
+                const request &r = requests[next % requests.size()];
+                f.op = r.op;
+                if (!send_request(fd, f.seq, r.op, r.timeout, r.command)) {
+                    return 1;
+                }
+            }
+            else if (pending.empty()) {
+                if (!send_request(fd, f.seq, PASSTHROUGH_END, 0, std::vector<uint8_t>())) {
+                    return 1;
+                }
+            }
+            else {
+                break;
+            }
+            pending.push_back(f);
+            next++;
+        }
+
+        struct pollfd pfd = { fd, POLLIN, 0 };
+        int ret = poll(&pfd, 1, RESPONSE_TIMEOUT);
+        if (ret <= 0) {
+            fprintf(stderr, "felica-passthrough: no response (%zu in flight)\n", pending.size());
+            return 1;
+        }
+        uint8_t buf[512];
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n <= 0) {
+            perror("read");
+            return 1;
+        }
+
+        for (ssize_t i = 0; (i < n) && !ended; i++) {
+            for (int ready = parser.put(buf[i]); ready && !ended; ready = parser.next()) {
+                if ((parser.type() != EVENT_PASSTHROUGH) || (parser.length() < PASSTHROUGH_RESPONSE_SIZE)) {
+                    continue;
+                }
+                const uint8_t *p = parser.payload();
+                int found = 0;
+                for (size_t k = 0; k < pending.size(); k++) {
+                    found |= (pending[k].seq == p[0]);
+                }
+                if (!found) {
+                    continue;   // from an earlier session
+                }
+                // requests run in order, so the ones before this were lost in damaged frames
+                while (pending.front().seq != p[0]) {
+                    printf("{\"seq\":%u,\"op\":\"%s\",\"status\":\"lost\"}\n", pending.front().seq, op_name(pending.front().op));
+                    pending.pop_front();
+                    lost++;
+                }
+                double round_trip = now() - pending.front().sent;
+                pending.pop_front();
+                if (p[1] == PASSTHROUGH_END) {
+                    ended = 1;
+                    break;
+                }
+                printf("{\"seq\":%u,\"op\":\"%s\",\"status\":\"%s\",\"wait_us\":%u,\"time_us\":%u,\"round_trip_us\":%u,\"response\":\"",
+                       p[0], op_name(p[1]), status_name(p[2]), le32(&p[3]), le32(&p[7]), (unsigned int)(round_trip * 1e6));
+                for (int k = PASSTHROUGH_RESPONSE_SIZE; k < parser.length(); k++) {
+                    printf("%02x", p[k]);
+                }
+                printf("\"}\n");
+                ok += (p[2] == PASSTHROUGH_OK);
+                rf_time += le32(&p[7]);
+            }
+        }
+    }
+
+    double elapsed = now() - start;
+    fprintf(stderr, "felica-passthrough: %zu requests (%zu ok, %zu lost) in %.3f s, %.1f requests/s, reader busy %.1f%%\n",
+            total, ok, lost, elapsed, total / elapsed, rf_time / (elapsed * 1e4));
+    if (parser.errors() != 0) {
+        fprintf(stderr, "felica-passthrough: %u bad frames\n", parser.errors());
+    }
+    close(fd);
+    return (lost == 0) ? 0 : 1;
+}
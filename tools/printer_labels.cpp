@@ -0,0 +1,168 @@
+/* Printer label table generator (host tool)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Reads the LABEL_LIST of Labels.h and writes the same strings in
+ * Shift_JIS as labels_sjis.h, so the firmware prints them as they are.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "sjis.h"
+
+struct label {
+    std::string id;
+    std::string text;
+    int source_line;
+};
+
+static void usage(void)
+{
+    fprintf(stderr,
+            "usage: printer-labels <Labels.h> -o <labels_sjis.h>\n");
+}
+
+/* ------------------------
+ * input
+ * ------------------------ */
+
+/* body of a C string literal starting after the opening quote */
+static bool parse_literal(const char *p, std::string &text)
+{
+    text.clear();
+    while (*p != '"') {
+        if (*p == '\0') {
+            return false;
+        }
+        if (*p != '\\') {
+            text += *p++;
+            continue;
+        }
+        p++;
+        switch (*p++) {
+            case 'r':
+                text += '\r';
+                break;
+            case 'n':
+                text += '\n';
+                break;
+            case 't':
+                text += '\t';
+                break;
+            case '\\':
+                text += '\\';
+                break;
+            case '"':
+                text += '"';
+                break;
+            default:
+                return false;
+        }
+    }
+    return true;
+}
+
+static bool parse_labels(FILE *fp, std::vector<label> &labels)
+{
+    char buf[1024];
+    int line_no = 0;
+    bool ok = true;
+
+    while (fgets(buf, sizeof(buf), fp) != NULL) {
+        line_no++;
+        const char *p = buf;
+        while ((*p == ' ') || (*p == '\t')) {
+            p++;
+        }
+        if (strncmp(p, "X(", 2) != 0) {
+            continue;
+        }
+        const char *comma = strchr(p, ',');
+        const char *quote = (comma != NULL) ? strchr(comma, '"') : NULL;
+        label l;
+        if ((quote == NULL) || !parse_literal(quote + 1, l.text)) {
+            fprintf(stderr, "line %d: expected X(id, \"text\")\n", line_no);
+            ok = false;
+            continue;
+        }
+        l.id.assign(p + 2, comma);
+        l.source_line = line_no;
+        labels.push_back(l);
+    }
+    return ok;
+}
+
+/* ------------------------
+ * output
+ * ------------------------ */
+
+/* octal escapes cannot run into the following character */
+static void write_literal(FILE *fp, const std::string &s)
+{
+    fputc('"', fp);
+    for (size_t i = 0; i < s.size(); i++) {
+        uint8_t c = (uint8_t)s[i];
+        if ((c < 0x20) || (c >= 0x7F) || (c == '\\') || (c == '"') || (c == '?')) {
+            fprintf(fp, "\\%03o", c);
+        } else {
+            fputc(c, fp);
+        }
+    }
+    fputc('"', fp);
+}
+
+int main(int argc, char **argv)
+{
+    if ((argc != 4) || (strcmp(argv[2], "-o") != 0)) {
+        usage();
+        return 2;
+    }
+
+    FILE *fp = fopen(argv[1], "r");
+    if (fp == NULL) {
+        perror(argv[1]);
+        return 1;
+    }
+    std::vector<label> labels;
+    bool ok = parse_labels(fp, labels);
+    fclose(fp);
+    if (!ok) {
+        return 1;
+    }
+
+    for (size_t i = 0; i < labels.size(); i++) {
+        if (!to_sjis(labels[i].text, labels[i].text)) {
+            fprintf(stderr, "line %d: %s has no Shift_JIS representation\n",
+                    labels[i].source_line, labels[i].id.c_str());
+            ok = false;
+        }
+    }
+    if (!ok) {
+        return 1;
+    }
+
+    fp = fopen(argv[3], "w");
+    if (fp == NULL) {
+        perror(argv[3]);
+        return 1;
+    }
+    const char *base = strrchr(argv[1], '/');
+    fprintf(fp, "/* Generated by printer-labels from %s. Do not edit. */\n\n", base ? base + 1 : argv[1]);
+    fprintf(fp, "static const char *const labels_sjis[] = {\n");
+    for (size_t i = 0; i < labels.size(); i++) {
+        fprintf(fp, "    ");
+        write_literal(fp, labels[i].text);
+        fprintf(fp, ",    // %s\n", labels[i].id.c_str());
+    }
+    fprintf(fp, "};\n");
+    if (fclose(fp) != 0) {
+        return 1;
+    }
+
+    fprintf(stderr, "%zu labels\n", labels.size());
+    return 0;
+}
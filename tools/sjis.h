@@ -0,0 +1,43 @@
+/* UTF-8 to Shift_JIS conversion for the host tools
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * The firmware never converts text itself. Strings for the printer are
+ * converted here, at build time, with iconv's CP932 table (Shift_JIS with
+ * the NEC and IBM extensions that Japanese thermal printers accept).
+ */
+
+#ifndef SJIS_H_
+#define SJIS_H_
+
+#include <iconv.h>
+
+#include <string>
+
+/* in and out may be the same string */
+static inline bool to_sjis(const std::string &in, std::string &out)
+{
+    static iconv_t cd = (iconv_t)-1;
+    if (cd == (iconv_t)-1) {
+        cd = iconv_open("CP932", "UTF-8");
+        if (cd == (iconv_t)-1) {
+            return false;
+        }
+    }
+
+    std::string src(in);
+    std::string dst(src.size() + 1, '\0');      // Shift_JIS is never longer
+    char *p = &src[0];
+    char *q = &dst[0];
+    size_t left = src.size();
+    size_t room = dst.size();
+
+    iconv(cd, NULL, NULL, NULL, NULL);
+    if (iconv(cd, &p, &left, &q, &room) == (size_t)-1) {
+        return false;
+    }
+    dst.resize(dst.size() - room);
+    out.swap(dst);
+    return true;
+}
+
+#endif /* !SJIS_H_ */
@@ -0,0 +1,798 @@
+/* Station database compiler (host tool)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Converts the StationCode CSV (or the legacy sc_utf8 fixed-record table)
+ * into the compact image read by StationDB.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "../StationDB.h"
+#include "sjis.h"
+
+#define LEGACY_RECORD_LENGTH    (3 + 40 + 40)
+#define LEGACY_NAME_LENGTH      40
+
+struct record {
+    int area;
+    int line;
+    int station;
+    std::string line_name;
+    std::string name;
+    int source_line;
+};
+
+/* bus_code.csv row */
+struct bus_record {
+    int code;
+    int stop;                   // STATION_DB_ANY_STOP for the operator name
+    std::string line_name;
+    std::string name;
+    int source_line;
+};
+
+struct options {
+    const char *input;
+    const char *bus;
+    const char *output;
+    const char *symbol;
+    bool header;
+    bool keep_first;
+    bool hex;
+    bool sjis;
+};
+
+static void usage(void)
+{
+    fprintf(stderr,
+            "usage: stationdb [options] <input>\n"
+            "\n"
+            "  <input>          StationCode CSV (.csv), legacy sc_utf8 table (.h) or\n"
+            "                   legacy binary records (any other extension, e.g. sc_utf8.bin)\n"
+            "  -o <file>        output file (.h writes a C array, otherwise raw image)\n"
+            "  -s <symbol>      array name for C output (default: sc_compact)\n"
+            "  --bus <csv>      bus/tram operator and stop names (see bus_code.csv)\n"
+            "  --hex            CSV codes are hexadecimal\n"
+            "  --keep-first     resolve duplicate codes like the legacy linear scan\n"
+            "  --sjis           store names in Shift_JIS (CP932) for the printer\n");
+}
+
+/* ------------------------
+ * input
+ * ------------------------ */
+
+static bool read_file(const char *path, std::vector<uint8_t> &data)
+{
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) {
+        perror(path);
+        return false;
+    }
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0) {
+        data.insert(data.end(), buf, buf + n);
+    }
+    fclose(fp);
+    return true;
+}
+
+static bool ends_with(const char *s, const char *suffix)
+{
+    size_t n = strlen(s);
+    size_t m = strlen(suffix);
+    return (n >= m) && (strcmp(s + n - m, suffix) == 0);
+}
+
+static std::string legacy_field(const uint8_t *p)
+{
+    size_t n = 0;
+    while ((n < LEGACY_NAME_LENGTH) && (p[n] != 0)) {
+        n++;
+    }
+    return std::string((const char *)p, n);
+}
+
+static bool parse_legacy(const std::vector<uint8_t> &data, std::vector<record> &records)
+{
+    if ((data.size() % LEGACY_RECORD_LENGTH) != 0) {
+        fprintf(stderr, "legacy table size %zu is not a multiple of %d\n",
+                data.size(), LEGACY_RECORD_LENGTH);
+        return false;
+    }
+    for (size_t offset = 0; offset < data.size(); offset += LEGACY_RECORD_LENGTH) {
+        const uint8_t *p = &data[offset];
+        record r;
+        r.area = p[0];
+        r.line = p[1];
+        r.station = p[2];
+        r.line_name = legacy_field(p + 3);
+        r.name = legacy_field(p + 3 + LEGACY_NAME_LENGTH);
+        r.source_line = (int)(offset / LEGACY_RECORD_LENGTH) + 1;
+        records.push_back(r);
+    }
+    return true;
+}
+
+/* the legacy header is a C array of 0x.. literals */
+static bool parse_legacy_header(const std::vector<uint8_t> &text, std::vector<record> &records)
+{
+    std::vector<uint8_t> data;
+    const char *p = (const char *)text.data();
+    const char *end = p + text.size();
+
+    while ((p < end) && (*p != '{')) {
+        p++;
+    }
+    while (p + 3 < end) {
+        if ((p[0] == '}')) {
+            break;
+        }
+        if ((p[0] == '0') && ((p[1] == 'x') || (p[1] == 'X'))) {
+            char *next;
+            data.push_back((uint8_t)strtoul(p, &next, 16));
+            p = next;
+        } else {
+            p++;
+        }
+    }
+    return parse_legacy(data, records);
+}
+
+static void split_csv(const std::string &line, std::vector<std::string> &fields)
+{
+    std::string field;
+    bool quoted = false;
+
+    fields.clear();
+    for (size_t i = 0; i < line.size(); i++) {
+        char c = line[i];
+        if (quoted) {
+            if ((c == '"') && (i + 1 < line.size()) && (line[i + 1] == '"')) {
+                field += '"';
+                i++;
+            } else if (c == '"') {
+                quoted = false;
+            } else {
+                field += c;
+            }
+        } else if (c == '"') {
+            quoted = true;
+        } else if (c == ',') {
+            fields.push_back(field);
+            field.clear();
+        } else if ((c != '\r') && (c != '\n')) {
+            field += c;
+        }
+    }
+    fields.push_back(field);
+}
+
+static bool parse_code(const std::string &s, bool hex, int *value)
+{
+    char *end;
+    if (s.empty()) {
+        return false;
+    }
+    long v = strtol(s.c_str(), &end, hex ? 16 : 0);
+    if ((*end != '\0') || (v < 0) || (v > 255)) {
+        return false;
+    }
+    *value = (int)v;
+    return true;
+}
+
+/*
+ * StationCode CSV columns:
+ *   area, line, station, company, line name, station name[, note]
+ * A leading header row and a UTF-8 BOM are skipped.
+ */
+static bool parse_csv(const std::vector<uint8_t> &data, bool hex, std::vector<record> &records)
+{
+    std::string text((const char *)data.data(), data.size());
+    std::vector<std::string> fields;
+    size_t pos = 0;
+    int line_no = 0;
+    bool ok = true;
+
+    if (text.compare(0, 3, "\xef\xbb\xbf") == 0) {
+        pos = 3;
+    }
+    while (pos < text.size()) {
+        size_t eol = text.find('\n', pos);
+        if (eol == std::string::npos) {
+            eol = text.size();
+        }
+        std::string line = text.substr(pos, eol - pos);
+        pos = eol + 1;
+        line_no++;
+
+        split_csv(line, fields);
+        if ((fields.size() == 1) && fields[0].empty()) {
+            continue;
+        }
+        record r;
+        if ((fields.size() < 6) ||
+            !parse_code(fields[0], hex, &r.area) ||
+            !parse_code(fields[1], hex, &r.line) ||
+            !parse_code(fields[2], hex, &r.station)) {
+            if (line_no == 1) {
+                continue;   // header row
+            }
+            fprintf(stderr, "line %d: malformed record\n", line_no);
+            ok = false;
+            continue;
+        }
+        r.line_name = fields[4];
+        r.name = fields[5];
+        r.source_line = line_no;
+        records.push_back(r);
+    }
+    return ok;
+}
+
+/*
+ * bus_code.csv columns:
+ *   operator code, stop code, operator name, stop name
+ * An empty stop code names the operator itself. Codes are 16 bit.
+ */
+static bool parse_bus_csv(const std::vector<uint8_t> &data, std::vector<bus_record> &records)
+{
+    std::string text((const char *)data.data(), data.size());
+    std::vector<std::string> fields;
+    size_t pos = 0;
+    int line_no = 0;
+    bool ok = true;
+
+    if (text.compare(0, 3, "\xef\xbb\xbf") == 0) {
+        pos = 3;
+    }
+    while (pos < text.size()) {
+        size_t eol = text.find('\n', pos);
+        if (eol == std::string::npos) {
+            eol = text.size();
+        }
+        std::string line = text.substr(pos, eol - pos);
+        pos = eol + 1;
+        line_no++;
+
+        split_csv(line, fields);
+        if ((fields.size() == 1) && fields[0].empty()) {
+            continue;
+        }
+        bus_record r;
+        char *end;
+        if (fields.size() >= 3) {
+            r.code = (int)strtol(fields[0].c_str(), &end, 0);
+        }
+        if ((fields.size() < 3) || fields[0].empty() || (*end != '\0') ||
+            (r.code < 0) || (r.code > 0xFFFF)) {
+            if (line_no == 1) {
+                continue;   // header row
+            }
+            fprintf(stderr, "bus line %d: malformed record\n", line_no);
+            ok = false;
+            continue;
+        }
+        r.stop = STATION_DB_ANY_STOP;
+        if (!fields[1].empty()) {
+            r.stop = (int)strtol(fields[1].c_str(), &end, 0);
+            if ((*end != '\0') || (r.stop < 0) || (r.stop >= STATION_DB_ANY_STOP)) {
+                fprintf(stderr, "bus line %d: malformed stop code\n", line_no);
+                ok = false;
+                continue;
+            }
+        }
+        r.line_name = fields[2];
+        r.name = (fields.size() > 3) ? fields[3] : "";
+        r.source_line = line_no;
+        records.push_back(r);
+    }
+    return ok;
+}
+
+/* ------------------------
+ * validation
+ * ------------------------ */
+
+static bool valid_utf8(const std::string &s)
+{
+    const uint8_t *p = (const uint8_t *)s.data();
+    const uint8_t *end = p + s.size();
+
+    while (p < end) {
+        uint32_t c = *p++;
+        int extra;
+        uint32_t min;
+        if (c < 0x80) {
+            if (c == 0) {
+                return false;
+            }
+            continue;
+        } else if ((c & 0xE0) == 0xC0) {
+            extra = 1;
+            min = 0x80;
+            c &= 0x1F;
+        } else if ((c & 0xF0) == 0xE0) {
+            extra = 2;
+            min = 0x800;
+            c &= 0x0F;
+        } else if ((c & 0xF8) == 0xF0) {
+            extra = 3;
+            min = 0x10000;
+            c &= 0x07;
+        } else {
+            return false;
+        }
+        if (end - p < extra) {
+            return false;
+        }
+        while (extra--) {
+            if ((*p & 0xC0) != 0x80) {
+                return false;
+            }
+            c = (c << 6) | (*p++ & 0x3F);
+        }
+        if ((c < min) || (c > 0x10FFFF) || ((c >= 0xD800) && (c <= 0xDFFF))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static uint32_t record_key(const record &r)
+{
+    return ((uint32_t)r.area << 16) | ((uint32_t)r.line << 8) | (uint32_t)r.station;
+}
+
+static bool validate(std::vector<record> &records, bool keep_first)
+{
+    bool ok = true;
+
+    for (size_t i = 0; i < records.size(); i++) {
+        const record &r = records[i];
+        if ((r.area > 3)) {
+            fprintf(stderr, "record %d: area code %d out of range\n", r.source_line, r.area);
+            ok = false;
+        }
+        if (r.name.empty() || !valid_utf8(r.name) || !valid_utf8(r.line_name)) {
+            fprintf(stderr, "record %d: malformed UTF-8 or empty name\n", r.source_line);
+            ok = false;
+        }
+        if ((r.name.size() >= STATION_DB_NAME_MAX) || (r.line_name.size() >= STATION_DB_NAME_MAX)) {
+            fprintf(stderr, "record %d: name longer than %d bytes\n", r.source_line, STATION_DB_NAME_MAX - 1);
+            ok = false;
+        }
+    }
+
+    /* stable sort keeps the first occurrence of a duplicate in front */
+    std::stable_sort(records.begin(), records.end(),
+    [](const record & a, const record & b) {
+        return record_key(a) < record_key(b);
+    });
+
+    std::vector<record> unique;
+    for (size_t i = 0; i < records.size(); i++) {
+        if (!unique.empty() && (record_key(unique.back()) == record_key(records[i]))) {
+            const record &first = unique.back();
+            const record &dup = records[i];
+            if ((first.line_name == dup.line_name) && (first.name == dup.name)) {
+                continue;
+            }
+            fprintf(stderr, "%s: duplicate code %d-%d-%d (record %d \"%s %s\", record %d \"%s %s\")\n",
+                    keep_first ? "warning" : "error",
+                    dup.area, dup.line, dup.station,
+                    first.source_line, first.line_name.c_str(), first.name.c_str(),
+                    dup.source_line, dup.line_name.c_str(), dup.name.c_str());
+            if (!keep_first) {
+                ok = false;
+            }
+            continue;
+        }
+        unique.push_back(records[i]);
+    }
+    records.swap(unique);
+
+    if (records.size() > 0xFFFF) {
+        fprintf(stderr, "too many stations (%zu)\n", records.size());
+        ok = false;
+    }
+    return ok;
+}
+
+static uint32_t bus_key(const bus_record &r)
+{
+    return ((uint32_t)r.code << 16) | (uint32_t)r.stop;
+}
+
+static bool validate_bus(std::vector<bus_record> &records)
+{
+    bool ok = true;
+
+    for (size_t i = 0; i < records.size(); i++) {
+        const bus_record &r = records[i];
+        if (r.line_name.empty() || !valid_utf8(r.line_name) || !valid_utf8(r.name) ||
+            ((r.stop != STATION_DB_ANY_STOP) && r.name.empty())) {
+            fprintf(stderr, "bus line %d: malformed UTF-8 or empty name\n", r.source_line);
+            ok = false;
+        }
+        if ((r.name.size() >= STATION_DB_NAME_MAX) || (r.line_name.size() >= STATION_DB_NAME_MAX)) {
+            fprintf(stderr, "bus line %d: name longer than %d bytes\n", r.source_line, STATION_DB_NAME_MAX - 1);
+            ok = false;
+        }
+    }
+
+    std::sort(records.begin(), records.end(),
+    [](const bus_record & a, const bus_record & b) {
+        return bus_key(a) < bus_key(b);
+    });
+    for (size_t i = 1; i < records.size(); i++) {
+        if (bus_key(records[i - 1]) == bus_key(records[i])) {
+            fprintf(stderr, "error: duplicate bus code %04X-%04X (lines %d and %d)\n",
+                    records[i].code, records[i].stop,
+                    records[i - 1].source_line, records[i].source_line);
+            ok = false;
+        }
+    }
+    if (records.size() > 0xFFFF) {
+        fprintf(stderr, "too many bus entries (%zu)\n", records.size());
+        ok = false;
+    }
+    return ok;
+}
+
+/* names are validated as UTF-8 first, so codes in messages stay readable */
+static bool encode_sjis(std::vector<record> &records, std::vector<bus_record> &buses)
+{
+    bool ok = true;
+
+    for (size_t i = 0; i < records.size(); i++) {
+        record &r = records[i];
+        if (!to_sjis(r.line_name, r.line_name) || !to_sjis(r.name, r.name)) {
+            fprintf(stderr, "record %d: \"%s\" has no Shift_JIS representation\n", r.source_line, r.name.c_str());
+            ok = false;
+        }
+    }
+    for (size_t i = 0; i < buses.size(); i++) {
+        bus_record &r = buses[i];
+        if (!to_sjis(r.line_name, r.line_name) || !to_sjis(r.name, r.name)) {
+            fprintf(stderr, "bus line %d: \"%s\" has no Shift_JIS representation\n", r.source_line, r.line_name.c_str());
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+/* ------------------------
+ * image
+ * ------------------------ */
+
+class string_pool
+{
+public:
+    explicit string_pool(uint32_t limit) : _limit(limit) {}
+
+    bool add(const std::string &s, uint32_t *offset)
+    {
+        std::map<std::string, uint32_t>::iterator it = _index.find(s);
+        if (it == _index.end()) {
+            if (_data.size() + s.size() + 1 > _limit) {
+                return false;
+            }
+            it = _index.insert(std::make_pair(s, (uint32_t)_data.size())).first;
+            _data.insert(_data.end(), s.begin(), s.end());
+            _data.push_back(0);
+        }
+        *offset = it->second;
+        return true;
+    }
+    bool add(const std::string &s, uint16_t *offset)
+    {
+        uint32_t v;
+        if (!add(s, &v) || (v > 0xFFFF)) {
+            return false;
+        }
+        *offset = (uint16_t)v;
+        return true;
+    }
+    const std::vector<uint8_t> &data(void) const
+    {
+        return _data;
+    }
+
+private:
+    uint32_t _limit;
+    std::map<std::string, uint32_t> _index;
+    std::vector<uint8_t> _data;
+};
+
+static uint32_t crc32(const uint8_t *data, size_t len)
+{
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+static void put16(std::vector<uint8_t> &out, uint16_t v)
+{
+    out.push_back((uint8_t)(v >> 0));
+    out.push_back((uint8_t)(v >> 8));
+}
+
+static void put24(std::vector<uint8_t> &out, uint32_t v)
+{
+    put16(out, (uint16_t)(v >> 0));
+    out.push_back((uint8_t)(v >> 16));
+}
+
+static void put32(std::vector<uint8_t> &out, uint32_t v)
+{
+    put16(out, (uint16_t)(v >> 0));
+    put16(out, (uint16_t)(v >> 16));
+}
+
+static uint32_t align4(std::vector<uint8_t> &out)
+{
+    while (out.size() & 3) {
+        out.push_back(0);
+    }
+    return (uint32_t)out.size();
+}
+
+static bool build_image(const std::vector<record> &records, const std::vector<bus_record> &buses,
+                        uint16_t encoding, std::vector<uint8_t> &image)
+{
+    string_pool lines(0xFFFF);                      // line_pool_size is 16 bits
+    string_pool names(STATION_DB_NAME_POOL_MAX);
+    std::vector<station_db_bus> bus_table;
+    std::vector<station_db_run> runs;
+    std::vector<uint8_t> codes;
+    std::vector<uint32_t> name_offsets;
+
+    for (size_t i = 0; i < records.size(); i++) {
+        const record &r = records[i];
+        uint16_t line_name;
+        uint32_t name;
+        if (!lines.add(r.line_name, &line_name)) {
+            fprintf(stderr, "line pool exceeds 64 KB\n");
+            return false;
+        }
+        if (!names.add(r.name, &name)) {
+            fprintf(stderr, "name pool exceeds 16 MB\n");
+            return false;
+        }
+        if (runs.empty() || (runs.back().area != r.area) || (runs.back().line != r.line) ||
+            (runs.back().line_name != line_name)) {
+            station_db_run run;
+            run.area = (uint8_t)r.area;
+            run.line = (uint8_t)r.line;
+            run.station = (uint8_t)r.station;
+            run.reserved = 0;
+            run.first = (uint16_t)i;
+            run.line_name = line_name;
+            runs.push_back(run);
+        }
+        codes.push_back((uint8_t)r.station);
+        name_offsets.push_back(name);
+    }
+    if (runs.size() > 0xFFFF) {
+        fprintf(stderr, "too many runs (%zu)\n", runs.size());
+        return false;
+    }
+
+    for (size_t i = 0; i < buses.size(); i++) {
+        station_db_bus bus;
+        bus.code = (uint16_t)buses[i].code;
+        bus.stop = (uint16_t)buses[i].stop;
+        bus.reserved = 0;
+        bus.name = STATION_DB_NO_NAME;
+        if (!lines.add(buses[i].line_name, &bus.line_name)) {
+            fprintf(stderr, "line pool exceeds 64 KB\n");
+            return false;
+        }
+        if (!buses[i].name.empty() && !names.add(buses[i].name, &bus.name)) {
+            fprintf(stderr, "name pool exceeds 16 MB\n");
+            return false;
+        }
+        bus_table.push_back(bus);
+    }
+
+    /* name indexes, in byte order of the (encoded) names */
+    std::vector<uint16_t> station_index(records.size());
+    for (size_t i = 0; i < records.size(); i++) {
+        station_index[i] = (uint16_t)i;
+    }
+    std::stable_sort(station_index.begin(), station_index.end(),
+    [&records](uint16_t a, uint16_t b) {
+        return records[a].name < records[b].name;
+    });
+    std::vector<uint16_t> line_index(runs.size());
+    for (size_t i = 0; i < runs.size(); i++) {
+        line_index[i] = (uint16_t)i;
+    }
+    std::stable_sort(line_index.begin(), line_index.end(),
+    [&records, &runs](uint16_t a, uint16_t b) {
+        return records[runs[a].first].line_name < records[runs[b].first].line_name;
+    });
+
+    station_db_header header;
+    memset(&header, 0, sizeof(header));
+    image.assign(sizeof(header), 0);
+
+    header.run_offset = align4(image);
+    for (size_t i = 0; i < runs.size(); i++) {
+        image.push_back(runs[i].area);
+        image.push_back(runs[i].line);
+        image.push_back(runs[i].station);
+        image.push_back(runs[i].reserved);
+        put16(image, runs[i].first);
+        put16(image, runs[i].line_name);
+    }
+    header.code_offset = align4(image);
+    image.insert(image.end(), codes.begin(), codes.end());
+    header.name_offset = align4(image);
+    for (size_t i = 0; i < name_offsets.size(); i++) {
+        put24(image, name_offsets[i]);
+    }
+    header.bus_offset = align4(image);
+    for (size_t i = 0; i < bus_table.size(); i++) {
+        put16(image, bus_table[i].code);
+        put16(image, bus_table[i].stop);
+        put16(image, bus_table[i].line_name);
+        put16(image, bus_table[i].reserved);
+        put32(image, bus_table[i].name);
+    }
+    header.station_index_offset = align4(image);
+    for (size_t i = 0; i < station_index.size(); i++) {
+        put16(image, station_index[i]);
+    }
+    header.line_index_offset = align4(image);
+    for (size_t i = 0; i < line_index.size(); i++) {
+        put16(image, line_index[i]);
+    }
+    header.line_pool_offset = align4(image);
+    image.insert(image.end(), lines.data().begin(), lines.data().end());
+    header.name_pool_offset = align4(image);
+    image.insert(image.end(), names.data().begin(), names.data().end());
+
+    header.magic = STATION_DB_MAGIC;
+    header.version = STATION_DB_VERSION;
+    header.run_count = (uint16_t)runs.size();
+    header.station_count = (uint16_t)records.size();
+    header.line_pool_size = (uint16_t)lines.data().size();
+    header.name_pool_size = (uint32_t)names.data().size();
+    header.bus_count = (uint16_t)bus_table.size();
+    header.encoding = encoding;
+    header.crc = crc32(image.data() + sizeof(header), image.size() - sizeof(header));
+
+    std::vector<uint8_t> raw;
+    put32(raw, header.magic);
+    put16(raw, header.version);
+    put16(raw, header.run_count);
+    put16(raw, header.station_count);
+    put16(raw, header.line_pool_size);
+    put32(raw, header.name_pool_size);
+    put32(raw, header.run_offset);
+    put32(raw, header.code_offset);
+    put32(raw, header.name_offset);
+    put32(raw, header.line_pool_offset);
+    put32(raw, header.name_pool_offset);
+    put16(raw, header.bus_count);
+    put16(raw, header.encoding);
+    put32(raw, header.bus_offset);
+    put32(raw, header.station_index_offset);
+    put32(raw, header.line_index_offset);
+    put32(raw, header.crc);
+    std::copy(raw.begin(), raw.end(), image.begin());
+
+    fprintf(stderr, "%u stations, %u runs, %u bus entries, line pool %u bytes, name pool %u bytes, image %zu bytes\n",
+            header.station_count, header.run_count, header.bus_count, header.line_pool_size,
+            header.name_pool_size, image.size());
+    return true;
+}
+
+/* ------------------------
+ * output
+ * ------------------------ */
+
+static bool write_image(const options &opt, const std::vector<uint8_t> &image)
+{
+    FILE *fp = fopen(opt.output, opt.header ? "w" : "wb");
+    if (fp == NULL) {
+        perror(opt.output);
+        return false;
+    }
+    if (opt.header) {
+        const char *base = strrchr(opt.input, '/');
+        fprintf(fp, "/* Generated by stationdb from %s. Do not edit. */\n\n", base ? base + 1 : opt.input);
+        fprintf(fp, "alignas(4) const unsigned char %s[] = {\n", opt.symbol);
+        for (size_t i = 0; i < image.size(); i++) {
+            fprintf(fp, "%s0x%02x,%s", (i % 16) == 0 ? "    " : "", image[i],
+                    ((i % 16) == 15 || i + 1 == image.size()) ? "\n" : " ");
+        }
+        fprintf(fp, "};\n\nconst unsigned int %s_len = %zu;\n", opt.symbol, image.size());
+    } else {
+        fwrite(image.data(), 1, image.size(), fp);
+    }
+    return fclose(fp) == 0;
+}
+
+int main(int argc, char **argv)
+{
+    options opt = { NULL, NULL, NULL, "sc_compact", false, false, false, false };
+
+    for (int i = 1; i < argc; i++) {
+        if ((strcmp(argv[i], "-o") == 0) && (i + 1 < argc)) {
+            opt.output = argv[++i];
+        } else if ((strcmp(argv[i], "-s") == 0) && (i + 1 < argc)) {
+            opt.symbol = argv[++i];
+        } else if ((strcmp(argv[i], "--bus") == 0) && (i + 1 < argc)) {
+            opt.bus = argv[++i];
+        } else if (strcmp(argv[i], "--hex") == 0) {
+            opt.hex = true;
+        } else if (strcmp(argv[i], "--keep-first") == 0) {
+            opt.keep_first = true;
+        } else if (strcmp(argv[i], "--sjis") == 0) {
+            opt.sjis = true;
+        } else if ((argv[i][0] == '-') || (opt.input != NULL)) {
+            usage();
+            return 2;
+        } else {
+            opt.input = argv[i];
+        }
+    }
+    if ((opt.input == NULL) || (opt.output == NULL)) {
+        usage();
+        return 2;
+    }
+    opt.header = ends_with(opt.output, ".h");
+
+    std::vector<uint8_t> data;
+    std::vector<record> records;
+    if (!read_file(opt.input, data)) {
+        return 1;
+    }
+    bool ok;
+    if (ends_with(opt.input, ".csv")) {
+        ok = parse_csv(data, opt.hex, records);
+    } else if (ends_with(opt.input, ".h")) {
+        ok = parse_legacy_header(data, records);
+    } else {
+        ok = parse_legacy(data, records);
+    }
+    if (!ok || !validate(records, opt.keep_first)) {
+        return 1;
+    }
+
+    std::vector<bus_record> buses;
+    if (opt.bus != NULL) {
+        std::vector<uint8_t> bus_data;
+        if (!read_file(opt.bus, bus_data) || !parse_bus_csv(bus_data, buses) || !validate_bus(buses)) {
+            return 1;
+        }
+    }
+
+    if (opt.sjis && !encode_sjis(records, buses)) {
+        return 1;
+    }
+
+    std::vector<uint8_t> image;
+    if (!build_image(records, buses, opt.sjis ? STATION_DB_SJIS : STATION_DB_UTF8, image) ||
+        !write_image(opt, image)) {
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,189 @@
+/* Station database query tool (host)
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Opens an image through the same code paths as the firmware: in place
+ * from memory, as a file, or from a file backed block device.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <vector>
+
+#include "../StationDBFile.h"
+
+static void usage(void)
+{
+    fprintf(stderr,
+            "usage: stationdb-query [options] <image> [area line station]...\n"
+            "\n"
+            "  --memory         map the whole image in memory (built-in table)\n"
+            "  --file           read the image as a file (LittleFS)\n"
+            "  --block <size>   read through a block device with <size> byte read units\n"
+            "                   (default: --block 1)\n"
+            "  --swap <image>   swap in another image before the lookups\n"
+            "  --all            print every station in the image\n"
+            "  --name <name>    stations with this name\n"
+            "  --prefix <text>  stations whose name starts with <text>\n"
+            "  --line <name>    lines with this name (first station)\n"
+            "  --line-prefix <text>\n"
+            "                   lines whose name starts with <text>\n");
+}
+
+static bool read_file(const char *path, std::vector<uint8_t> &data)
+{
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) {
+        perror(path);
+        return false;
+    }
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0) {
+        data.insert(data.end(), buf, buf + n);
+    }
+    fclose(fp);
+    return true;
+}
+
+enum mode {
+    MODE_MEMORY,
+    MODE_FILE,
+    MODE_BLOCK
+};
+
+struct source {
+    std::vector<uint8_t> image;
+    FileBlockDevice *bd;
+};
+
+static int load(StationDBSlot &slot, source &src, const char *path, mode m, int read_size)
+{
+    switch (m) {
+        case MODE_MEMORY:
+            if (!read_file(path, src.image)) {
+                return 0;
+            }
+            return slot.load(src.image.data(), (uint32_t)src.image.size());
+        case MODE_FILE:
+            return slot.load(new FileStationDBReader(path));
+        case MODE_BLOCK:
+        default:
+            src.bd = new FileBlockDevice(path, read_size);
+            return slot.load(new BlockDeviceStationDBReader(src.bd));
+    }
+}
+
+static void print_station(StationDB *db, int area, int line, int station)
+{
+    station_ref ref;
+    if (db->find(area, line, station, &ref)) {
+        printf("%d %d %d %s線 %s駅\n", area, line, station, db->lineName(ref), db->stationName(ref));
+    } else {
+        printf("%d %d %d -\n", area, line, station);
+    }
+}
+
+struct name_query {
+    const char *key;
+    int match;
+    bool line;
+};
+
+static void print_names(StationDB *db, const name_query &q)
+{
+    station_code codes[64];
+    int n = q.line ? db->findLineName(q.key, q.match, codes, 64)
+                   : db->findName(q.key, q.match, codes, 64);
+    for (int i = 0; (i < n) && (i < 64); i++) {
+        print_station(db, codes[i].area, codes[i].line, codes[i].station);
+    }
+    if (n > 64) {
+        printf("... %d more\n", n - 64);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    mode m = MODE_BLOCK;
+    int read_size = 1;
+    const char *image = NULL;
+    const char *swap = NULL;
+    bool all = false;
+    std::vector<int> codes;
+    std::vector<name_query> names;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--memory") == 0) {
+            m = MODE_MEMORY;
+        } else if (strcmp(argv[i], "--file") == 0) {
+            m = MODE_FILE;
+        } else if ((strcmp(argv[i], "--block") == 0) && (i + 1 < argc)) {
+            m = MODE_BLOCK;
+            read_size = atoi(argv[++i]);
+        } else if ((strcmp(argv[i], "--swap") == 0) && (i + 1 < argc)) {
+            swap = argv[++i];
+        } else if (strcmp(argv[i], "--all") == 0) {
+            all = true;
+        } else if ((strcmp(argv[i], "--name") == 0) && (i + 1 < argc)) {
+            name_query q = { argv[++i], STATION_DB_EXACT, false };
+            names.push_back(q);
+        } else if ((strcmp(argv[i], "--prefix") == 0) && (i + 1 < argc)) {
+            name_query q = { argv[++i], STATION_DB_PREFIX, false };
+            names.push_back(q);
+        } else if ((strcmp(argv[i], "--line") == 0) && (i + 1 < argc)) {
+            name_query q = { argv[++i], STATION_DB_EXACT, true };
+            names.push_back(q);
+        } else if ((strcmp(argv[i], "--line-prefix") == 0) && (i + 1 < argc)) {
+            name_query q = { argv[++i], STATION_DB_PREFIX, true };
+            names.push_back(q);
+        } else if (argv[i][0] == '-') {
+            usage();
+            return 2;
+        } else if (image == NULL) {
+            image = argv[i];
+        } else {
+            codes.push_back((int)strtol(argv[i], NULL, 0));
+        }
+    }
+    if ((image == NULL) || (read_size < 1) || ((codes.size() % 3) != 0)) {
+        usage();
+        return 2;
+    }
+
+    StationDBSlot slot;
+    source src[2] = { { std::vector<uint8_t>(), NULL }, { std::vector<uint8_t>(), NULL } };
+    if (!load(slot, src[0], image, m, read_size)) {
+        fprintf(stderr, "%s: not a valid station database\n", image);
+        return 1;
+    }
+    if ((swap != NULL) && !load(slot, src[1], swap, m, read_size)) {
+        fprintf(stderr, "%s: not a valid station database, keeping %s\n", swap, image);
+    }
+
+    StationDB *db = slot.lock();
+    fprintf(stderr, "generation %u, %u stations, crc %08x\n",
+            slot.generation(), db->count(), db->crc());
+    for (size_t i = 0; i < codes.size(); i += 3) {
+        print_station(db, codes[i], codes[i + 1], codes[i + 2]);
+    }
+    for (size_t i = 0; i < names.size(); i++) {
+        print_names(db, names[i]);
+    }
+    if (all) {
+        station_ref ref;
+        for (int area = 0; area < 4; area++) {
+            for (int line = 0; line < 256; line++) {
+                for (int station = 0; station < 256; station++) {
+                    if (db->find(area, line, station, &ref)) {
+                        print_station(db, area, line, station);
+                    }
+                }
+            }
+        }
+    }
+    slot.unlock();
+
+    return 0;
+}